@@ -0,0 +1,200 @@
+#include "constants.hh"
+#include "gameboy.hh"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdio.h>
+#include <string.h>
+#include <utility>
+
+// runs roms headless for a fixed number of frames and reports throughput.
+// every run starts from power on with empty cartridge ram, so the same rom
+// and frame count always emulate exactly the same work
+
+struct Workload {
+  std::string rom;
+  int frames;
+};
+
+struct RunResult {
+  double fps;
+  double mips; // emulated instructions per host second, in millions
+  std::vector<int64_t> frame_ns;
+};
+
+static void usage() {
+  printf("Usage: gbbench [--frames n] [--runs n] [--skip-boot] [--no-render] "
+         "[--json results.json] [--suite file] [path/to/rom]...\n"
+         "a suite file lists one rom per line, optionally followed by its own "
+         "frame count; # starts a comment\n");
+  exit(1);
+}
+
+static void load_suite(const char *suite_file, int default_frames,
+                       std::vector<Workload> &workloads) {
+  std::ifstream in(suite_file);
+  if (!in) {
+    std::cerr << "Could not read suite " << suite_file << std::endl;
+    exit(1);
+  }
+  std::string line;
+  while (std::getline(in, line)) {
+    line = line.substr(0, line.find('#'));
+    std::istringstream fields(line);
+    Workload workload;
+    if (!(fields >> workload.rom)) {
+      continue;
+    }
+    if (!(fields >> workload.frames)) {
+      workload.frames = default_frames;
+    }
+    workloads.push_back(workload);
+  }
+}
+
+static RunResult run_once(const Workload &workload, bool skip_boot,
+                          bool render) {
+  Gameboy gameboy((char *)workload.rom.c_str(), true);
+  gameboy.clear_ram();
+  if (skip_boot) {
+    // the boot rom is the same for every game, so it is left out of the
+    // timing to keep it from diluting short workloads
+    while (!gameboy.boot_done()) {
+      gameboy.run_frame(false);
+    }
+  }
+
+  RunResult result;
+  result.frame_ns.reserve(workload.frames);
+  uint64_t first_instruction = gameboy.instruction_count();
+  int64_t start = monotonic_ns();
+  int64_t last = start;
+  for (int frame = 0; frame < workload.frames; frame++) {
+    gameboy.run_frame(render);
+    int64_t now = monotonic_ns();
+    result.frame_ns.push_back(now - last);
+    last = now;
+  }
+  double seconds = (last - start) / 1e9;
+  result.fps = workload.frames / seconds;
+  result.mips =
+      (gameboy.instruction_count() - first_instruction) / seconds / 1e6;
+  return result;
+}
+
+template <typename T> static T percentile(std::vector<T> values, double p) {
+  std::sort(values.begin(), values.end());
+  size_t index = std::min(values.size() - 1, (size_t)(values.size() * p));
+  return values[index];
+}
+
+static std::string json_string(const std::string &value) {
+  std::string out = "\"";
+  for (char c : value) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+    }
+    out += c;
+  }
+  return out + "\"";
+}
+
+int main(int argc, char *argv[]) {
+  int frames = 3600;
+  int runs = 5;
+  bool skip_boot = false;
+  bool render = true;
+  char *json_file = NULL;
+  // suites and roms are only loaded once every option is read, so --frames
+  // applies wherever it appears
+  std::vector<std::pair<char *, bool>> inputs; // path, whether it is a suite
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+      frames = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+      runs = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+      json_file = argv[++i];
+    } else if (strcmp(argv[i], "--suite") == 0 && i + 1 < argc) {
+      inputs.emplace_back(argv[++i], true);
+    } else if (strcmp(argv[i], "--skip-boot") == 0) {
+      skip_boot = true;
+    } else if (strcmp(argv[i], "--no-render") == 0) {
+      render = false;
+    } else if (argv[i][0] != '-') {
+      inputs.emplace_back(argv[i], false);
+    } else {
+      usage();
+    }
+  }
+  if (frames <= 0 || runs <= 0) {
+    usage();
+  }
+  std::vector<Workload> workloads;
+  for (const std::pair<char *, bool> &input : inputs) {
+    if (input.second) {
+      load_suite(input.first, frames, workloads);
+    } else {
+      workloads.push_back({input.first, frames});
+    }
+  }
+  if (workloads.empty()) {
+    usage();
+  }
+
+  std::ostringstream json;
+  json << "{\n  \"frames_per_second_at_normal_speed\": "
+       << 1000.0 / FRAME_PERIOD << ",\n  \"runs\": " << runs
+       << ",\n  \"skip_boot\": " << (skip_boot ? "true" : "false")
+       << ",\n  \"render\": " << (render ? "true" : "false")
+       << ",\n  \"compiler\": " << json_string(__VERSION__)
+       << ",\n  \"workloads\": [";
+
+  for (size_t w = 0; w < workloads.size(); w++) {
+    const Workload &workload = workloads[w];
+    if (workload.frames <= 0) {
+      std::cerr << "No frames to run for " << workload.rom << std::endl;
+      exit(1);
+    }
+    std::vector<double> fps, mips;
+    std::vector<int64_t> frame_ns;
+    for (int run = 0; run < runs; run++) {
+      RunResult result = run_once(workload, skip_boot, render);
+      fps.push_back(result.fps);
+      mips.push_back(result.mips);
+      frame_ns.insert(frame_ns.end(), result.frame_ns.begin(),
+                      result.frame_ns.end());
+    }
+
+    // throughput is judged per run, frame times over every frame of every run
+    double fps_median = percentile(fps, 0.5);
+    double mips_median = percentile(mips, 0.5);
+    int64_t ns_median = percentile(frame_ns, 0.5);
+    int64_t ns_p99 = percentile(frame_ns, 0.99);
+    printf("%s: %d frames x %d runs, %.0f fps (min %.0f, max %.0f), "
+           "%.2f MIPS, %.0f ns/frame (p99 %.0f)\n",
+           workload.rom.c_str(), workload.frames, runs, fps_median,
+           percentile(fps, 0.0), percentile(fps, 1.0), mips_median,
+           (double)ns_median, (double)ns_p99);
+
+    json << (w == 0 ? "" : ",") << "\n    {\"rom\": "
+         << json_string(workload.rom) << ", \"frames\": " << workload.frames
+         << ", \"fps_median\": " << fps_median
+         << ", \"fps_min\": " << percentile(fps, 0.0)
+         << ", \"fps_max\": " << percentile(fps, 1.0)
+         << ", \"mips_median\": " << mips_median
+         << ", \"ns_per_frame_median\": " << ns_median
+         << ", \"ns_per_frame_p99\": " << ns_p99 << "}";
+  }
+  json << "\n  ]\n}\n";
+
+  if (json_file != NULL) {
+    std::ofstream out(json_file);
+    if (!(out << json.str())) {
+      std::cerr << "Could not write " << json_file << std::endl;
+      return 1;
+    }
+  }
+  return 0;
+}
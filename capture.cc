@@ -0,0 +1,148 @@
+#include "capture.hh"
+#include "convert.hh"
+#include "savestate.hh"
+#include <cstring>
+#include <iostream>
+
+static const size_t FRAME_SIZE = SCREEN_WIDTH * SCREEN_HEIGHT;
+
+VideoCapture::VideoCapture(const std::string &file_name) : writer(out) {
+  file = fopen(file_name.c_str(), "wb");
+  if (file == NULL) {
+    std::cerr << "Could not create " << file_name << std::endl;
+    exit(1);
+  }
+  // writes are already batched into large blocks
+  setvbuf(file, NULL, _IONBF, 0);
+  y4m = file_name.size() >= 4 &&
+        file_name.compare(file_name.size() - 4, 4, ".y4m") == 0;
+
+  for (int i = 0; i < CAPTURE_SLOTS; i++) {
+    slots[i].resize(FRAME_SIZE);
+    free_slots.push_back(i);
+  }
+  ready_slots.reserve(CAPTURE_SLOTS);
+  previous.assign(FRAME_SIZE, 0);
+  out.reserve(CAPTURE_WRITE_SIZE + 2 * FRAME_SIZE);
+  encoded = 0;
+
+  if (y4m) {
+    // 70224 cycles per frame at 4194304 hz
+    const char *header =
+        "YUV4MPEG2 W160 H144 F4194304:70224 Ip A1:1 Cmono\n";
+    out.insert(out.end(), header, header + strlen(header));
+  } else {
+    writer.value<uint32_t>(CAPTURE_MAGIC);
+    writer.value<uint32_t>(CAPTURE_VERSION);
+    writer.value<uint32_t>(SCREEN_WIDTH);
+    writer.value<uint32_t>(SCREEN_HEIGHT);
+    for (int shade = 0; shade < 4; shade++) {
+      writer.value<uint32_t>(dmg_palette_rgba[shade]);
+    }
+  }
+
+  captured = 0;
+  dropped = 0;
+  shutdown = false;
+  worker = std::thread(&VideoCapture::worker_loop, this);
+}
+
+VideoCapture::~VideoCapture() {
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    shutdown = true;
+  }
+  work_ready.notify_one();
+  worker.join();
+  flush();
+  fclose(file);
+  std::cerr << "Captured " << captured << " frames, dropped " << dropped
+            << std::endl;
+}
+
+void VideoCapture::push(const uint8_t *screen) {
+  int slot;
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    if (free_slots.empty()) {
+      dropped++;
+      return;
+    }
+    slot = free_slots.back();
+    free_slots.pop_back();
+  }
+
+  // the slot belongs to this thread until it is marked ready
+  memcpy(slots[slot].data(), screen, FRAME_SIZE);
+
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    ready_slots.push_back(slot);
+    captured++;
+  }
+  work_ready.notify_one();
+}
+
+uint64_t VideoCapture::frames_dropped() {
+  std::lock_guard<std::mutex> guard(lock);
+  return dropped;
+}
+
+void VideoCapture::worker_loop() {
+  std::unique_lock<std::mutex> guard(lock);
+  while (true) {
+    work_ready.wait(guard,
+                    [this] { return shutdown || !ready_slots.empty(); });
+    if (ready_slots.empty()) {
+      // only exit once everything queued is on its way to disk
+      return;
+    }
+    int slot = ready_slots.front();
+    ready_slots.erase(ready_slots.begin());
+    guard.unlock();
+
+    encode(slots[slot]);
+    if (out.size() >= CAPTURE_WRITE_SIZE) {
+      flush();
+    }
+
+    guard.lock();
+    free_slots.push_back(slot);
+  }
+}
+
+void VideoCapture::encode(const std::vector<uint8_t> &frame) {
+  if (y4m) {
+    static const char *frame_header = "FRAME\n";
+    out.insert(out.end(), frame_header, frame_header + 6);
+    for (uint8_t shade : frame) {
+      out.push_back(dmg_palette_rgba[shade & 3] >> 24); // red as luma
+    }
+    return;
+  }
+
+  bool key = encoded % CAPTURE_KEYFRAME_INTERVAL == 0;
+  if (key) {
+    std::fill(previous.begin(), previous.end(), 0);
+  }
+  out.push_back(key ? 0 : 1);
+  size_t i = 0;
+  while (i < FRAME_SIZE) {
+    uint8_t value = frame[i] ^ previous[i];
+    size_t start = i;
+    while (i < FRAME_SIZE && (frame[i] ^ previous[i]) == value) {
+      i++;
+    }
+    writer.varint(i - start);
+    out.push_back(value);
+  }
+  previous = frame;
+  encoded++;
+}
+
+void VideoCapture::flush() {
+  if (!out.empty() && fwrite(out.data(), 1, out.size(), file) != out.size()) {
+    std::cerr << "Could not write capture" << std::endl;
+  }
+  out.clear();
+}
@@ -0,0 +1,360 @@
+#include "gameboy.hh"
+#include <algorithm>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+// runs test roms headless, one child process per rom and as many at once as
+// there are cores, and tells from what each rom reports whether it passed:
+//   - blargg's tests print "Passed" or "Failed" over the serial port, and
+//     some also leave a result code at 0xA000 behind the signature DE B0 61
+//   - mooneye's tests execute LD B,B with B, C, D, E, H and L holding the
+//     fibonacci numbers 3 5 8 13 21 34 on success and all 0x42 on failure
+//   - anything that reports neither way (e.g. dmg-acid2) is checked against
+//     the hash of a reference frame kept next to the rom in name.golden,
+//     which --update-golden writes from the current build for such roms
+// whatever the rom reports, a savestate of where it stopped must then draw
+// the same frames in a fresh machine and in a fork. a child that exits (e.g.
+// an unsupported cartridge) or crashes only fails its own rom
+
+#define ROUND_TRIP_FRAMES (3)
+
+enum test_status { PASS, FAIL, TIMEOUT, ERROR, GOLDEN_WRITTEN };
+
+static const char *status_names[] = {"PASS", "FAIL", "TIMEOUT", "ERROR",
+                                     "NEW"};
+
+// what a child sends back over its pipe
+struct TestResult {
+  test_status status;
+  int frames;
+  char detail[96];
+};
+
+struct Test {
+  std::string rom;
+  pid_t pid;
+  int pipe_fd;
+  int64_t start;
+  TestResult result;
+  int64_t wall_ns;
+};
+
+static void usage() {
+  printf("Usage: gbtest [--jobs n] [--frames n] [--update-golden] "
+         "path/to/rom-or-directory...\n"
+         "directories are searched recursively for .gb files; --frames is "
+         "the most a rom may run before it times out (default 7200)\n");
+  exit(1);
+}
+
+static std::string golden_path(const std::string &rom) {
+  std::filesystem::path path(rom);
+  return path.replace_extension(".golden").string();
+}
+
+static uint64_t frame_hash(const Gameboy &gameboy) {
+  return fnv1a(gameboy.get_screen(), SCREEN_WIDTH * SCREEN_HEIGHT);
+}
+
+// the last line of what the rom printed, for the table
+static std::string last_line(const std::string &serial) {
+  std::string text = serial;
+  while (!text.empty() && (text.back() == '\n' || text.back() == ' ')) {
+    text.pop_back();
+  }
+  text = text.substr(text.find_last_of('\n') + 1);
+  for (char &c : text) {
+    if (c < ' ' || c > '~') {
+      c = '?';
+    }
+  }
+  return text;
+}
+
+static void set_detail(TestResult &result, const std::string &detail) {
+  snprintf(result.detail, sizeof(result.detail), "%s", detail.c_str());
+}
+
+// a savestate of where the rom stopped, loaded into a fresh machine and into a
+// fork, has to draw the same frames as the machine it was taken from
+static bool states_round_trip(Gameboy &gameboy, const std::string &rom) {
+  std::vector<uint8_t> state;
+  gameboy.save_state(state);
+  Gameboy loaded((char *)rom.c_str(), true);
+  if (!loaded.load_state(state.data(), state.size())) {
+    return false;
+  }
+  std::unique_ptr<Gameboy> forked = gameboy.fork();
+  for (int frame = 0; frame < ROUND_TRIP_FRAMES; frame++) {
+    gameboy.run_frame();
+    loaded.run_frame();
+    forked->run_frame();
+    uint64_t hash = frame_hash(gameboy);
+    if (frame_hash(loaded) != hash || frame_hash(*forked) != hash) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static TestResult run_rom(Gameboy &gameboy, const std::string &rom,
+                          int max_frames, bool update_golden) {
+  TestResult result;
+  result.status = TIMEOUT;
+  result.frames = 0;
+  result.detail[0] = '\0';
+
+  // a golden frame only stands in for roms that report nothing themselves,
+  // so they run the full length unless they do
+  uint64_t golden_hash = 0;
+  int golden_frames = 0;
+  std::ifstream golden(golden_path(rom));
+  bool has_golden =
+      !update_golden && (golden >> golden_frames >> std::hex >> golden_hash);
+  bool use_golden = has_golden || update_golden;
+  int frames = has_golden ? golden_frames : max_frames;
+
+  size_t serial_checked = 0;
+  uint64_t breakpoints = 0;
+  for (int frame = 0; frame < frames; frame++) {
+    // only the frame a golden hash is taken of has to be drawn
+    gameboy.run_frame(use_golden && frame == frames - 1);
+    result.frames = frame + 1;
+
+    const std::string &serial = gameboy.serial_output();
+    if (serial.size() != serial_checked) {
+      serial_checked = serial.size();
+      if (serial.find("Failed") != std::string::npos) {
+        result.status = FAIL;
+      } else if (serial.find("Passed") != std::string::npos) {
+        result.status = PASS;
+      }
+      if (result.status != TIMEOUT) {
+        set_detail(result, "serial: " + last_line(serial));
+        return result;
+      }
+    }
+
+    if (gameboy.breakpoint_count() != breakpoints) {
+      breakpoints = gameboy.breakpoint_count();
+      CpuRegisters regs = gameboy.cpu_registers();
+      if (regs.b == 3 && regs.c == 5 && regs.d == 8 && regs.e == 13 &&
+          regs.h == 21 && regs.l == 34) {
+        result.status = PASS;
+        set_detail(result, "fibonacci registers at LD B,B");
+        return result;
+      }
+      if (regs.b == 0x42 && regs.c == 0x42 && regs.d == 0x42 &&
+          regs.e == 0x42 && regs.h == 0x42 && regs.l == 0x42) {
+        result.status = FAIL;
+        set_detail(result, "registers all 0x42 at LD B,B");
+        return result;
+      }
+    }
+
+    // 0x80 while the test is still running
+    if (gameboy.peek_byte(0xA001) == 0xDE &&
+        gameboy.peek_byte(0xA002) == 0xB0 &&
+        gameboy.peek_byte(0xA003) == 0x61 &&
+        gameboy.peek_byte(0xA000) != 0x80) {
+      uint8_t code = gameboy.peek_byte(0xA000);
+      result.status = code == 0 ? PASS : FAIL;
+      char detail[32];
+      snprintf(detail, sizeof(detail), "result code %d", code);
+      set_detail(result, detail);
+      return result;
+    }
+  }
+
+  if (!use_golden) {
+    if (!gameboy.serial_output().empty()) {
+      set_detail(result, "serial: " + last_line(gameboy.serial_output()));
+    }
+    return result;
+  }
+  uint64_t hash = frame_hash(gameboy);
+  char detail[64];
+  if (update_golden) {
+    std::ofstream out(golden_path(rom));
+    if (!(out << frames << " " << std::hex << hash << "\n")) {
+      result.status = ERROR;
+      set_detail(result, "could not write " + golden_path(rom));
+      return result;
+    }
+    result.status = GOLDEN_WRITTEN;
+    snprintf(detail, sizeof(detail), "frame hash %016llx",
+             (unsigned long long)hash);
+  } else if (hash == golden_hash) {
+    result.status = PASS;
+    snprintf(detail, sizeof(detail), "frame hash matches");
+  } else {
+    result.status = FAIL;
+    snprintf(detail, sizeof(detail), "frame hash %016llx, expected %016llx",
+             (unsigned long long)hash, (unsigned long long)golden_hash);
+  }
+  set_detail(result, detail);
+  return result;
+}
+
+static TestResult run_test(const std::string &rom, int max_frames,
+                           bool update_golden) {
+  Gameboy gameboy((char *)rom.c_str(), true);
+  gameboy.clear_ram();
+  gameboy.capture_serial();
+  TestResult result = run_rom(gameboy, rom, max_frames, update_golden);
+  if (!states_round_trip(gameboy, rom)) {
+    result.status = FAIL;
+    set_detail(result, "savestate round trip draws a different frame");
+  }
+  return result;
+}
+
+static void start_test(Test &test, int max_frames, bool update_golden) {
+  int fds[2];
+  if (pipe(fds) != 0) {
+    std::cerr << "Could not create a pipe" << std::endl;
+    exit(1);
+  }
+  fflush(stdout);
+  fflush(stderr);
+  test.start = monotonic_ns();
+  test.pid = fork();
+  if (test.pid < 0) {
+    std::cerr << "Could not fork" << std::endl;
+    exit(1);
+  }
+  if (test.pid == 0) {
+    // the core prints cartridge details to stdout, which would interleave
+    // with the table
+    close(fds[0]);
+    int null_fd = open("/dev/null", O_WRONLY);
+    dup2(null_fd, STDOUT_FILENO);
+    dup2(null_fd, STDERR_FILENO);
+    TestResult result = run_test(test.rom, max_frames, update_golden);
+    ssize_t written = write(fds[1], &result, sizeof(result));
+    _exit(written == sizeof(result) ? 0 : 1);
+  }
+  close(fds[1]);
+  test.pipe_fd = fds[0];
+}
+
+// the result fits in the pipe's buffer, so the child never waits on us
+static void finish_test(Test &test, int wait_status) {
+  test.wall_ns = monotonic_ns() - test.start;
+  if (read(test.pipe_fd, &test.result, sizeof(test.result)) !=
+      sizeof(test.result)) {
+    test.result.status = ERROR;
+    test.result.frames = 0;
+    if (WIFSIGNALED(wait_status)) {
+      snprintf(test.result.detail, sizeof(test.result.detail),
+               "killed by signal %d", WTERMSIG(wait_status));
+    } else {
+      snprintf(test.result.detail, sizeof(test.result.detail),
+               "exited with %d, run it with ./gameboy to see why",
+               WEXITSTATUS(wait_status));
+    }
+  }
+  close(test.pipe_fd);
+}
+
+static void add_roms(const std::string &path, std::vector<Test> &tests) {
+  std::error_code error;
+  if (!std::filesystem::is_directory(path, error)) {
+    tests.push_back({path, 0, -1, 0, {}, 0});
+    return;
+  }
+  std::vector<std::string> roms;
+  for (const auto &entry :
+       std::filesystem::recursive_directory_iterator(path, error)) {
+    if (entry.is_regular_file() && entry.path().extension() == ".gb") {
+      roms.push_back(entry.path().string());
+    }
+  }
+  std::sort(roms.begin(), roms.end());
+  for (const std::string &rom : roms) {
+    tests.push_back({rom, 0, -1, 0, {}, 0});
+  }
+}
+
+int main(int argc, char *argv[]) {
+  int jobs = std::max(1u, std::thread::hardware_concurrency());
+  int max_frames = 7200;
+  bool update_golden = false;
+  std::vector<Test> tests;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+      jobs = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+      max_frames = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--update-golden") == 0) {
+      update_golden = true;
+    } else if (argv[i][0] != '-') {
+      add_roms(argv[i], tests);
+    } else {
+      usage();
+    }
+  }
+  if (tests.empty() || jobs <= 0 || max_frames <= 0) {
+    usage();
+  }
+
+  size_t name_width = 3;
+  for (const Test &test : tests) {
+    name_width = std::max(name_width, test.rom.size());
+  }
+  printf("%-*s  %-7s %6s %9s  %s\n", (int)name_width, "rom", "result",
+         "frames", "wall ms", "detail");
+
+  // results are printed in the order the roms were given
+  int64_t start = monotonic_ns();
+  size_t next = 0, printed = 0;
+  int running = 0;
+  std::vector<bool> done(tests.size());
+  while (printed < tests.size()) {
+    while (running < jobs && next < tests.size()) {
+      start_test(tests[next++], max_frames, update_golden);
+      running++;
+    }
+    int wait_status;
+    pid_t pid = wait(&wait_status);
+    if (pid < 0) {
+      std::cerr << "Lost track of the running tests" << std::endl;
+      exit(1);
+    }
+    for (size_t i = 0; i < next; i++) {
+      if (!done[i] && tests[i].pid == pid) {
+        finish_test(tests[i], wait_status);
+        done[i] = true;
+        running--;
+      }
+    }
+    while (printed < tests.size() && done[printed]) {
+      const Test &test = tests[printed++];
+      printf("%-*s  %-7s %6d %9.1f  %s\n", (int)name_width, test.rom.c_str(),
+             status_names[test.result.status], test.result.frames,
+             test.wall_ns / 1e6, test.result.detail);
+    }
+  }
+
+  int counts[5] = {0};
+  int64_t rom_ns = 0;
+  for (const Test &test : tests) {
+    counts[test.result.status]++;
+    rom_ns += test.wall_ns;
+  }
+  printf("\n%d passed, %d failed, %d timed out, %d errors", counts[PASS],
+         counts[FAIL], counts[TIMEOUT], counts[ERROR]);
+  if (counts[GOLDEN_WRITTEN] > 0) {
+    printf(", %d golden frames written", counts[GOLDEN_WRITTEN]);
+  }
+  printf(" in %.2f s (%.2f s of rom time on %d jobs)\n",
+         (monotonic_ns() - start) / 1e9, rom_ns / 1e9, jobs);
+  return counts[FAIL] + counts[TIMEOUT] + counts[ERROR] > 0 ? 1 : 0;
+}
@@ -0,0 +1,73 @@
+#include "convert.hh"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CONVERT_SSSE3
+#endif
+
+const uint32_t dmg_palette_rgba[4] = {
+    0xFFFFFFFF, // white
+    0xAAAAAAFF, // light gray
+    0x555555FF, // dark gray
+    0x000000FF, // black
+};
+
+#ifdef CONVERT_SSSE3
+// byte (shift / 8) of each palette entry as a pshufb table, so one shuffle
+// looks up that byte for 16 shades at once
+static __m128i byte_table(const uint32_t *palette, int shift) {
+  uint8_t table[16] = {0};
+  for (int shade = 0; shade < 4; shade++) {
+    table[shade] = palette[shade] >> shift;
+  }
+  return _mm_loadu_si128((const __m128i *)table);
+}
+
+__attribute__((target("ssse3"))) static size_t
+shades_to_rgba_ssse3(const uint8_t *src, uint32_t *dst, size_t count,
+                     const uint32_t palette[4]) {
+  const __m128i mask = _mm_set1_epi8(3);
+  const __m128i b0 = byte_table(palette, 0);
+  const __m128i b1 = byte_table(palette, 8);
+  const __m128i b2 = byte_table(palette, 16);
+  const __m128i b3 = byte_table(palette, 24);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m128i shades =
+        _mm_and_si128(_mm_loadu_si128((const __m128i *)(src + i)), mask);
+    __m128i c0 = _mm_shuffle_epi8(b0, shades);
+    __m128i c1 = _mm_shuffle_epi8(b1, shades);
+    __m128i c2 = _mm_shuffle_epi8(b2, shades);
+    __m128i c3 = _mm_shuffle_epi8(b3, shades);
+    // interleave the four byte planes back into little endian pixels
+    __m128i lo01 = _mm_unpacklo_epi8(c0, c1);
+    __m128i hi01 = _mm_unpackhi_epi8(c0, c1);
+    __m128i lo23 = _mm_unpacklo_epi8(c2, c3);
+    __m128i hi23 = _mm_unpackhi_epi8(c2, c3);
+    __m128i *out = (__m128i *)(dst + i);
+    _mm_storeu_si128(out, _mm_unpacklo_epi16(lo01, lo23));
+    _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(lo01, lo23));
+    _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(hi01, hi23));
+    _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(hi01, hi23));
+  }
+  return i;
+}
+
+static bool have_ssse3() {
+  static const bool supported = __builtin_cpu_supports("ssse3");
+  return supported;
+}
+#endif
+
+void shades_to_rgba(const uint8_t *src, uint32_t *dst, size_t count,
+                    const uint32_t palette[4]) {
+  size_t i = 0;
+#ifdef CONVERT_SSSE3
+  if (have_ssse3()) {
+    i = shades_to_rgba_ssse3(src, dst, count, palette);
+  }
+#endif
+  for (; i < count; i++) {
+    dst[i] = palette[src[i] & 3];
+  }
+}
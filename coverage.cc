@@ -0,0 +1,127 @@
+#include "coverage.hh"
+#include "savestate.hh"
+#include <cstdio>
+
+static size_t bitmap_size(uint32_t rom_size) {
+  return ((size_t)rom_size + COVERAGE_RAM_SIZE + 7) / 8;
+}
+
+static uint32_t count_bits(const std::vector<uint8_t> &bitmap, uint32_t start,
+                           uint32_t end) {
+  uint32_t count = 0;
+  for (uint32_t location = start; location < end; location++) {
+    count += (bitmap[location >> 3] >> (location & 7)) & 1;
+  }
+  return count;
+}
+
+// bytes that are either, since overlapping code can make a byte both
+static uint32_t count_either(const std::vector<uint8_t> *bitmaps,
+                             uint32_t start, uint32_t end) {
+  uint32_t count = 0;
+  for (uint32_t location = start; location < end; location++) {
+    count += ((bitmaps[COVERAGE_OPCODE][location >> 3] |
+               bitmaps[COVERAGE_OPERAND][location >> 3]) >>
+              (location & 7)) &
+             1;
+  }
+  return count;
+}
+
+Coverage::Coverage() {
+  rom_hash = 0;
+  rom_size = 0;
+}
+
+Coverage::Coverage(uint64_t rom_hash, uint32_t rom_size) {
+  this->rom_hash = rom_hash;
+  this->rom_size = rom_size;
+  for (std::vector<uint8_t> &bitmap : bits) {
+    bitmap.assign(bitmap_size(rom_size), 0);
+  }
+}
+
+bool Coverage::is_marked(coverage_kind kind, uint32_t rom_offset) const {
+  return rom_offset < rom_size &&
+         (bits[kind][rom_offset >> 3] >> (rom_offset & 7)) & 1;
+}
+
+bool Coverage::merge(const std::string &file_name) {
+  FILE *file = fopen(file_name.c_str(), "rb");
+  if (file == NULL) {
+    return false;
+  }
+  std::vector<uint8_t> buffer;
+  uint8_t chunk[4096];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+    buffer.insert(buffer.end(), chunk, chunk + n);
+  }
+  fclose(file);
+
+  StateReader in(buffer.data(), buffer.size());
+  uint32_t magic = in.value<uint32_t>();
+  uint32_t version = in.value<uint32_t>();
+  uint64_t file_rom_hash = in.value<uint64_t>();
+  uint32_t file_rom_size = in.value<uint32_t>();
+  if (!in.ok() || magic != COVERAGE_MAGIC || version != COVERAGE_VERSION ||
+      in.remaining() != NUM_COVERAGE_KINDS * bitmap_size(file_rom_size)) {
+    return false;
+  }
+  if (bits[0].empty()) {
+    *this = Coverage(file_rom_hash, file_rom_size);
+  } else if (file_rom_hash != rom_hash || file_rom_size != rom_size) {
+    return false;
+  }
+  for (std::vector<uint8_t> &bitmap : bits) {
+    for (uint8_t &byte : bitmap) {
+      byte |= in.value<uint8_t>();
+    }
+  }
+  return true;
+}
+
+bool Coverage::save(const std::string &file_name) const {
+  std::vector<uint8_t> buffer;
+  StateWriter out(buffer);
+  out.value<uint32_t>(COVERAGE_MAGIC);
+  out.value<uint32_t>(COVERAGE_VERSION);
+  out.value<uint64_t>(rom_hash);
+  out.value<uint32_t>(rom_size);
+  for (const std::vector<uint8_t> &bitmap : bits) {
+    out.write(bitmap.data(), bitmap.size());
+  }
+  FILE *file = fopen(file_name.c_str(), "wb");
+  if (file == NULL) {
+    return false;
+  }
+  bool written = fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+  return fclose(file) == 0 && written;
+}
+
+void Coverage::print() const {
+  if (rom_size == 0) {
+    return;
+  }
+  uint32_t opcodes = count_bits(bits[COVERAGE_OPCODE], 0, rom_size);
+  uint32_t operands = count_bits(bits[COVERAGE_OPERAND], 0, rom_size);
+  uint32_t ram_opcodes = count_bits(bits[COVERAGE_OPCODE], rom_size,
+                                    rom_size + COVERAGE_RAM_SIZE);
+  fprintf(stderr,
+          "Coverage: %u instructions and %u operand bytes, %.2f%% of the "
+          "%u KiB rom; %u instructions run from ram\n",
+          opcodes, operands, 100.0 * count_either(bits, 0, rom_size) / rom_size,
+          rom_size / 1024, ram_opcodes);
+  fprintf(stderr, "  %-4s %12s %12s %7s\n", "bank", "instructions", "operands",
+          "bytes");
+  for (uint32_t bank = 0; bank * 0x4000 < rom_size; bank++) {
+    uint32_t start = bank * 0x4000;
+    uint32_t bank_opcodes = count_bits(bits[COVERAGE_OPCODE], start,
+                                       start + 0x4000);
+    uint32_t bank_operands = count_bits(bits[COVERAGE_OPERAND], start,
+                                        start + 0x4000);
+    fprintf(stderr, "  %-4u %12u %12u %6.2f%%\n", bank, bank_opcodes,
+            bank_operands,
+            100.0 * count_either(bits, start, start + 0x4000) / 0x4000);
+  }
+}
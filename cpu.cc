@@ -1,5 +1,7 @@
 #include "cpu.hh"
 #include "constants.hh"
+#include "guest_profiler.hh"
+#include "trace.hh"
 #include <cstdint>
 #include <cstring>
 #include <pthread.h>
@@ -22,16 +24,18 @@ Cpu::Cpu(Memory& mem) : mmu(mem) {
   HL.reg = 0x014D;
   ime = 0;
   set_ime = false;
+  is_last_instr_ei = false;
   is_prefix = false;
   halt_bug = false;
   instr_cycles = 0;
+  instructions = 0;
+  breakpoints = 0;
+  guest_profiler = NULL;
+  coverage = NULL;
 
   // set screen
   // memset(screen, 0, sizeof(screen));
 
-  init_opcode_table();
-  init_prefix_table();
-
   //cout << "set up instruction tables and initialized memory" << endl;
 }
 
@@ -110,12 +114,19 @@ unsigned short Cpu::read_r16(REGISTER r16) {
 }
 
 unsigned char Cpu::next8() {
+#ifdef GB_COVERAGE
+  cover(COVERAGE_OPERAND, pc);
+#endif
   unsigned char data = mmu.read_byte(pc);
   pc++;
   return data;
 }
 
 unsigned short Cpu::next16() {
+#ifdef GB_COVERAGE
+  cover(COVERAGE_OPERAND, pc);
+  cover(COVERAGE_OPERAND, pc + 1);
+#endif
   unsigned short data = mmu.read_word(pc);
   pc += 2;
   return data;
@@ -147,6 +158,9 @@ bool Cpu::service_interrupt() {
   uint8_t ief = if_reg & mmu.read_byte(IE_REG); // enabled and requested
   if (ief && state == HALTED) {
     state = RUNNING;
+    if (mmu.get_trace() != NULL) {
+      mmu.get_trace()->record(TRACE_HALT_EXIT);
+    }
   }
 
   if (!ime) {
@@ -186,32 +200,103 @@ bool Cpu::service_interrupt() {
   mmu.write_byte(--sp, pc & 0xFF);
   
   pc = interrupt_address;
+  if (mmu.get_trace() != NULL) {
+    mmu.get_trace()->record(TRACE_INTERRUPT_SERVICE, interrupt_type);
+  }
+  if (guest_profiler != NULL) {
+    guest_profiler->on_interrupt(pc, sp);
+  }
   uint8_t mask = 1 << interrupt_type;
   mmu.write_byte(IF_REG, if_reg & ~mask);
   ime = 0;
   return true;
 }
 
+void Cpu::set_guest_profiler(GuestProfiler *profiler) {
+  guest_profiler = profiler;
+}
+
+void Cpu::set_coverage(Coverage *coverage) { this->coverage = coverage; }
+
+CpuRegisters Cpu::registers() const {
+  return {AF.first, AF.second, BC.first, BC.second, DE.first,
+          DE.second, HL.first, HL.second, sp,        pc};
+}
+
+void Cpu::save_state(StateWriter &state) const {
+  state.value<uint16_t>(AF.reg);
+  state.value<uint16_t>(BC.reg);
+  state.value<uint16_t>(DE.reg);
+  state.value<uint16_t>(HL.reg);
+  state.value<uint16_t>(sp);
+  state.value<uint16_t>(pc);
+  state.value<uint8_t>(this->state);
+  state.value<uint8_t>(ime);
+  state.value<uint8_t>(set_ime);
+  state.value<uint8_t>(is_last_instr_ei);
+  state.value<uint8_t>(is_prefix);
+  state.value<uint8_t>(instr_cycles);
+  state.value<uint8_t>(halt_bug);
+}
+
+void Cpu::load_state(StateReader &state) {
+  AF.reg = state.value<uint16_t>();
+  BC.reg = state.value<uint16_t>();
+  DE.reg = state.value<uint16_t>();
+  HL.reg = state.value<uint16_t>();
+  sp = state.value<uint16_t>();
+  pc = state.value<uint16_t>();
+  this->state = (CPU_STATE)state.value<uint8_t>();
+  ime = state.value<uint8_t>();
+  set_ime = state.value<uint8_t>();
+  is_last_instr_ei = state.value<uint8_t>();
+  is_prefix = state.value<uint8_t>();
+  instr_cycles = state.value<uint8_t>();
+  halt_bug = state.value<uint8_t>();
+}
+
 uint8_t Cpu::fetch_and_execute() {
   instr_cycles = 0;
   if (state == BOOTING && pc == 0x100) state = RUNNING;
+#ifdef GB_OPCODE_STATS
+  uint16_t instr_pc = pc;
+#endif
+#ifdef GB_MEMORY_STATS
+  mmu.count_fetch(pc);
+#endif
   unsigned char opcode = mmu.read_byte(pc);
+#ifdef GB_OPCODE_STATS
+  uint16_t stats_index = opcode;
+#endif
+#ifdef GB_COVERAGE
+  cover(COVERAGE_OPCODE, pc);
+#endif
   // print_registers();
   pc++;
   if (halt_bug) {
     pc--;
     halt_bug = false;
   }
-  auto& opcode_function = opcode_table[opcode];
+  instruction_t opcode_function = opcode_table[opcode];
   // handle 0xCB (prefix instruction); execute prefixed instruction immediately
   if (opcode == 0xCB) {
-    opcode = mmu.read_byte(pc);
-    pc++;
+    opcode = next8();
     opcode_function = prefix_table[opcode];
+#ifdef GB_OPCODE_STATS
+    stats_index = 0x100 | opcode;
+#endif
   }
 
   if (opcode_function) {
-    opcode_function();
+    opcode_function(*this);
+    instructions++;
+    if (guest_profiler != NULL) {
+      guest_profiler->add_cycles(instr_cycles << 2);
+    }
+#ifdef GB_OPCODE_STATS
+    opcode_stats.count(stats_index, instr_cycles << 2,
+                       mmu.rom_bank_at(instr_pc), instr_pc);
+#endif
     AF.second &= 0xF0;
     if (is_last_instr_ei) {
       is_last_instr_ei = false;
@@ -281,8 +366,7 @@ void Cpu::ld_r16_a(REGISTER r16) {
 
 void Cpu::ld_n16_a() {
   // copy the value in register A into the byte at address n16
-  unsigned short loc = mmu.read_word(pc);
-  pc += 2;
+  unsigned short loc = next16();
   mmu.write_byte(loc, AF.first);
   instr_cycles = 4;
 }
@@ -290,8 +374,7 @@ void Cpu::ld_n16_a() {
 void Cpu::ldh_n8_a() {
   // copy the value in register A into the byte at address n8
   // provided the address is between 0xFF00 and 0xFFFF
-  unsigned char loc = mmu.read_byte(pc);
-  pc += 1;
+  unsigned char loc = next8();
   mmu.write_byte(0xFF00 + loc, AF.first);
   instr_cycles = 3;
 }
@@ -944,6 +1027,9 @@ void Cpu::call_n16() {
   mmu.write_byte(--sp, pc & 0xFF);
   
   pc = n16;
+  if (guest_profiler != NULL) {
+    guest_profiler->on_call(pc, sp);
+  }
   instr_cycles = 6;
 }
 
@@ -954,7 +1040,7 @@ void Cpu::call_cc_n16(int flag, bool condition) {
   }
   else {
     instr_cycles = 3;
-    pc += 2;
+    next16(); // the operand is still fetched
   }
 }
 
@@ -975,7 +1061,7 @@ void Cpu::jp_cc_n16(int flag, bool condition) {
     // jp_n16() sets the number of cycles
   }
   else {
-    pc += 2;
+    next16(); // the operand is still fetched
     instr_cycles = 3;
   }
 }
@@ -992,12 +1078,15 @@ void Cpu::jr_cc_e8(int flag, bool condition) {
     // jr_e8() sets the number of cycles
   }
   else {
-    pc++;
+    next8(); // the operand is still fetched
     instr_cycles = 2;
   }
 }
 
 void Cpu::ret() {
+  if (guest_profiler != NULL) {
+    guest_profiler->on_return(sp);
+  }
   pc = mmu.read_word(sp);
   sp += 2;
   instr_cycles = 4;
@@ -1026,6 +1115,9 @@ void Cpu::rst_vec(uint8_t n) {
   mmu.write_byte(--sp, pc >> 8); // most significant byte
   mmu.write_byte(--sp, pc & 0xFF);
   pc = addr;
+  if (guest_profiler != NULL) {
+    guest_profiler->on_call(pc, sp);
+  }
   instr_cycles = 4;
 }
 
@@ -1176,6 +1268,9 @@ void Cpu::halt() {
   if (ime) {
     if (!interrupts_pending) {
       state = HALTED;
+      if (mmu.get_trace() != NULL) {
+        mmu.get_trace()->record(TRACE_HALT_ENTER);
+      }
     }
     else {
       service_interrupt();
@@ -1189,6 +1284,9 @@ void Cpu::halt() {
     }
     else {
       state = HALTED;
+      if (mmu.get_trace() != NULL) {
+        mmu.get_trace()->record(TRACE_HALT_ENTER);
+      }
     }
   }
 }
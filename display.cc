@@ -0,0 +1,202 @@
+#include "display.hh"
+#include "convert.hh"
+#include "profiler.hh"
+#include <SDL2/SDL_error.h>
+#include <SDL2/SDL_timer.h>
+#include <cstring>
+#include <iostream>
+
+FrameMailbox::FrameMailbox() {
+  memset(buffers, 0, sizeof(buffers));
+  back = 0;
+  middle = 1;
+  front = 2;
+}
+
+uint8_t *FrameMailbox::back_buffer() { return buffers[back]; }
+
+void FrameMailbox::publish() {
+  back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & 3;
+}
+
+const uint8_t *FrameMailbox::take() {
+  if ((middle.load(std::memory_order_relaxed) & FRESH) == 0) {
+    return NULL;
+  }
+  front = middle.exchange(front, std::memory_order_acq_rel) & 3;
+  return buffers[front];
+}
+
+InputQueue::InputQueue() {
+  head = 0;
+  tail = 0;
+}
+
+bool InputQueue::push(const SDL_Event &event) {
+  uint32_t h = head.load(std::memory_order_relaxed);
+  if (h - tail.load(std::memory_order_acquire) == INPUT_QUEUE_SIZE) {
+    return false;
+  }
+  events[h & (INPUT_QUEUE_SIZE - 1)] = event;
+  head.store(h + 1, std::memory_order_release);
+  return true;
+}
+
+bool InputQueue::pop(SDL_Event &event) {
+  uint32_t t = tail.load(std::memory_order_relaxed);
+  if (t == head.load(std::memory_order_acquire)) {
+    return false;
+  }
+  event = events[t & (INPUT_QUEUE_SIZE - 1)];
+  tail.store(t + 1, std::memory_order_release);
+  return true;
+}
+
+Display::Display() {
+  closed = false;
+  last_present = 0;
+  init_sdl();
+}
+
+Display::~Display() { shutdown_sdl(); }
+
+void Display::init_sdl() {
+  // init SDL
+  if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_TIMER) < 0) {
+    std::cerr << "Could not initialize SDL: " << SDL_GetError() << std::endl;
+    std::exit(1);
+  }
+
+  // init SDL window
+  window = SDL_CreateWindow("gb-emu", SDL_WINDOWPOS_CENTERED,
+                            SDL_WINDOWPOS_CENTERED, SCREEN_WIDTH * SCALE_FACTOR,
+                            SCREEN_HEIGHT * SCALE_FACTOR,
+                            SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE);
+  if (window == NULL) {
+    std::cerr << "Could not create SDL window: " << SDL_GetError() << std::endl;
+    std::exit(1);
+  }
+
+  // init SDL renderer
+  renderer = SDL_CreateRenderer(
+      window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+  if (renderer == NULL) {
+    std::cerr << "Could not create SDL renderer: " << SDL_GetError()
+              << std::endl;
+    std::exit(1);
+  }
+  SDL_RenderSetLogicalSize(renderer, SCREEN_WIDTH, SCREEN_HEIGHT);
+
+  texture = NULL;
+  create_texture(1);
+
+  // the nominal rate is only a starting point, presents measure the real one
+  SDL_DisplayMode mode;
+  int refresh_rate = 60;
+  if (SDL_GetCurrentDisplayMode(SDL_GetWindowDisplayIndex(window), &mode) ==
+          0 &&
+      mode.refresh_rate > 0) {
+    refresh_rate = mode.refresh_rate;
+  }
+  refresh_period = 1000000000LL / refresh_rate;
+}
+
+void Display::create_texture(int scale) {
+  if (texture != NULL) {
+    SDL_DestroyTexture(texture);
+  }
+  texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888,
+                              SDL_TEXTUREACCESS_STREAMING,
+                              SCREEN_WIDTH * scale, SCREEN_HEIGHT * scale);
+  if (texture == NULL) {
+    std::cerr << "Could not create SDL texture: " << SDL_GetError()
+              << std::endl;
+    std::exit(1);
+  }
+}
+
+void Display::set_filter(upscale_filter filter) {
+  if (filter == FILTER_NONE) {
+    upscaler.reset();
+    create_texture(1);
+  } else {
+    upscaler = std::make_unique<Upscaler>(filter);
+    create_texture(upscaler->get_scale());
+  }
+}
+
+void Display::shutdown_sdl() {
+  SDL_DestroyTexture(texture);
+  SDL_DestroyRenderer(renderer);
+  SDL_DestroyWindow(window);
+  SDL_Quit();
+}
+
+void Display::run() {
+  PROFILE_ZONE(ZONE_POLL);
+  while (!closed.load(std::memory_order_acquire)) {
+    SDL_Event event;
+    while (SDL_PollEvent(&event)) {
+      if (event.type == SDL_QUIT || event.type == SDL_KEYDOWN ||
+          event.type == SDL_KEYUP) {
+        input.push(event);
+      }
+    }
+
+    const uint8_t *frame = frames.take();
+    if (frame == NULL) {
+      // nothing new to show yet
+      SDL_Delay(1);
+      continue;
+    }
+    // shades become colors on the way into the texture
+    {
+      PROFILE_ZONE(ZONE_UPLOAD);
+      void *pixels;
+      int pitch;
+      if (upscaler && SDL_LockTexture(texture, NULL, &pixels, &pitch) == 0) {
+        upscaler->run(frame, (uint32_t *)pixels, pitch);
+        SDL_UnlockTexture(texture);
+      } else if (SDL_LockTexture(texture, NULL, &pixels, &pitch) == 0) {
+        for (int y = 0; y < SCREEN_HEIGHT; y++) {
+          shades_to_rgba(frame + y * SCREEN_WIDTH,
+                         (uint32_t *)((uint8_t *)pixels + y * pitch),
+                         SCREEN_WIDTH, dmg_palette_rgba);
+        }
+        SDL_UnlockTexture(texture);
+      }
+    }
+    {
+      PROFILE_ZONE(ZONE_PRESENT);
+      SDL_RenderClear(renderer);
+      SDL_RenderCopy(renderer, texture, NULL, NULL);
+      SDL_RenderPresent(renderer); // waits for vsync
+    }
+    PROFILE_FLUSH();
+
+    int64_t now = monotonic_ns();
+    int64_t previous = last_present.load(std::memory_order_relaxed);
+    int64_t period = refresh_period.load(std::memory_order_relaxed);
+    int64_t interval = now - previous;
+    // intervals spanning a missed refresh say nothing about the rate
+    if (previous != 0 && interval > period * 3 / 4 &&
+        interval < period * 5 / 4) {
+      refresh_period.store(period + (interval - period) / 16,
+                           std::memory_order_relaxed);
+    }
+    last_present.store(now, std::memory_order_relaxed);
+  }
+  if (upscaler) {
+    upscaler->print_stats();
+  }
+}
+
+void Display::close() { closed.store(true, std::memory_order_release); }
+
+int64_t Display::vsync_time() const {
+  return last_present.load(std::memory_order_relaxed);
+}
+
+int64_t Display::vsync_period() const {
+  return refresh_period.load(std::memory_order_relaxed);
+}
@@ -1,124 +1,453 @@
 #include "gameboy.hh"
 #include "constants.hh"
+#include "profiler.hh"
 #include <SDL2/SDL_error.h>
 #include <SDL2/SDL_render.h>
 #include <SDL2/SDL_timer.h>
+#include <chrono>
 #include <iostream>
+#include <thread>
 
-Gameboy::Gameboy(char *rom_file)
+Gameboy::Gameboy(char *rom_file, bool headless)
     : mmu(rom_file), cpu(mmu), gpu(mmu), timer(mmu), joypad(mmu) {
   mmu.set_timer(&timer);
   mmu.set_joypad(&joypad);
   mmu.set_cpu(&cpu);
-  init_sdl();
-  gpu.init_sdl(renderer, texture);
-}
-
-void Gameboy::init_sdl() {
-  // init SDL
-  if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_TIMER) < 0) {
-    std::cerr << "Could not initialize SDL: " << SDL_GetError() << std::endl;
-    std::exit(1);
+  run_ahead = 0;
+  vsync_lock = false;
+  last_drawn = 0;
+  last_frame_end = 0;
+  speed_start = 0;
+  speed_frames = 0;
+  metrics.instances.fetch_add(1, std::memory_order_relaxed);
+  if (!headless) {
+    display = std::make_unique<Display>();
+    gpu.set_mailbox(&display->frames);
+    joypad.set_input_queue(&display->input);
   }
+}
 
-  // init SDL window
-  window = SDL_CreateWindow("gb-emu", SDL_WINDOWPOS_CENTERED,
-                            SDL_WINDOWPOS_CENTERED, SCREEN_WIDTH * SCALE_FACTOR,
-                            SCREEN_HEIGHT * SCALE_FACTOR,
-                            SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE);
-  if (window == NULL) {
-    std::cerr << "Could not create SDL window: " << SDL_GetError() << std::endl;
-    std::exit(1);
-  }
+// the memory copy shares every page (and the rom) with the parent. the other
+// components only hold a few registers, which go through their savestate code
+Gameboy::Gameboy(const Gameboy &parent)
+    : mmu(parent.mmu), cpu(mmu), gpu(mmu), timer(mmu), joypad(mmu) {
+  mmu.set_timer(&timer);
+  mmu.set_joypad(&joypad);
+  mmu.set_cpu(&cpu);
+  mmu.set_trace(NULL);
+  mmu.set_memory_stats(NULL);
+  mmu.set_serial_output(NULL);
+  run_ahead = 0;
+  vsync_lock = false;
+  last_drawn = 0;
+  last_frame_end = 0;
+  speed_start = 0;
+  speed_frames = 0;
+  metrics.instances.fetch_add(1, std::memory_order_relaxed);
 
-  // init SDL renderer
-  renderer = SDL_CreateRenderer(
-      window, -1, SDL_RENDERER_ACCELERATED /*| SDL_RENDERER_PRESENTVSYNC*/);
-  if (renderer == NULL) {
-    std::cerr << "Could not create SDL renderer: " << SDL_GetError()
-              << std::endl;
-    std::exit(1);
-  }
-  SDL_RenderSetLogicalSize(renderer, SCREEN_WIDTH, SCREEN_HEIGHT);
+  std::vector<uint8_t> buffer;
+  StateWriter writer(buffer);
+  parent.cpu.save_state(writer);
+  parent.timer.save_state(writer);
+  parent.gpu.save_state(writer);
+  parent.joypad.save_state(writer);
+  StateReader reader(buffer.data(), buffer.size());
+  cpu.load_state(reader);
+  timer.load_state(reader);
+  gpu.load_state(reader);
+  joypad.load_state(reader);
+}
 
-  // init SDL texture
-  texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888,
-                              SDL_TEXTUREACCESS_STREAMING, SCREEN_WIDTH,
-                              SCREEN_HEIGHT);
-  if (texture == NULL) {
-    std::cerr << "Could not create SDL texture: " << SDL_GetError()
-              << std::endl;
-    std::exit(1);
+Gameboy::~Gameboy() {
+  metrics.instances.fetch_sub(1, std::memory_order_relaxed);
+  if (coverage) {
+    if (!coverage->save(coverage_file)) {
+      std::cerr << "Could not write " << coverage_file << std::endl;
+    }
+    coverage->print();
   }
 }
 
-void Gameboy::shutdown_sdl() {
-  SDL_DestroyTexture(texture);
-  SDL_DestroyRenderer(renderer);
-  SDL_DestroyWindow(window);
-  SDL_Quit();
+std::unique_ptr<Gameboy> Gameboy::fork() const {
+  return std::unique_ptr<Gameboy>(new Gameboy(*this));
 }
 
 void Gameboy::start() {
+  std::thread emulation(&Gameboy::emulate, this);
+  display->run();
+  emulation.join();
+  display.reset();
+}
+
+void Gameboy::emulate() {
+  rewind_buffer = std::make_unique<RewindBuffer>();
   while (!joypad.quit) {
-    joypad.handle_input();
+    {
+      PROFILE_ZONE(ZONE_INPUT);
+      joypad.handle_input();
+    }
+    {
+      PROFILE_ZONE(ZONE_REWIND);
+      if (movie) {
+        // rewinding would break the recording so it is off while recording
+        if (movie->is_hash_frame(movie->length())) {
+          movie->record_hash(state_hash());
+        }
+        movie->record(joypad.get_buttons());
+      } else if (joypad.rewinding) {
+        // step back a frame but keep the keys that are held right now
+        uint8_t buttons = joypad.get_buttons();
+        rewind_buffer->rewind(*this);
+        joypad.set_buttons(buttons);
+      } else {
+        rewind_buffer->push(*this);
+      }
+    }
     update();
   }
-  mmu.save_ram();
-  shutdown_sdl();
+  rewind_buffer.reset();
+  if (movie) {
+    if (movie->save(movie_file)) {
+      std::cout << "Recorded " << movie->length() << " frames to "
+                << movie_file << std::endl;
+    } else {
+      std::cerr << "Could not write movie " << movie_file << std::endl;
+    }
+  } else {
+    mmu.save_ram();
+  }
+  pacer.print_stats();
+#ifdef GB_OPCODE_STATS
+  cpu.opcode_stats.print();
+#endif
+  display->close();
 }
 
 void Gameboy::update() {
+  // faster than real time there are more frames than display refreshes. only
+  // the ones the display has time for are drawn, the others still run the ppu
+  // so its timing and interrupts stay exact
+  int64_t start = monotonic_ns();
+  bool draw = display == NULL ||
+              start - last_drawn >= display->vsync_period() * 7 / 8;
+  if (draw) {
+    last_drawn = start;
+  }
+
+  if (run_ahead > 0) {
+    run_ahead_frame(draw);
+  } else {
+    run_frame(draw);
+  }
+
+  int64_t busy = monotonic_ns() - start;
+  int64_t budget = 0;
+  if (joypad.speed == UNCAPPED_SPEED) {
+    pacer.reset();
+  } else {
+    if (vsync_lock && display) {
+      pacer.lock_to_vsync(display->vsync_time(), display->vsync_period());
+    }
+    pacer.set_period(FRAME_PERIOD / joypad.speed);
+    budget = FRAME_PERIOD * 1e6 / joypad.speed;
+    PROFILE_ZONE(ZONE_SLEEP);
+    PacerWait waited = pacer.wait();
+    if (waited.waited) {
+      metrics.overshoot(waited.overshoot_ns);
+    } else if (waited.late_ns > 0) {
+      metrics.late(waited.late_ns);
+    }
+  }
+
+  speed_frames++;
+  int64_t now = monotonic_ns();
+  if (last_frame_end != 0) {
+    metrics.frame(now - last_frame_end, busy, budget);
+  }
+  last_frame_end = now;
+  if (speed_start == 0) {
+    speed_start = now;
+    speed_frames = 0;
+  } else if (now - speed_start >= 1000000000LL) {
+    if (joypad.speed != NORMAL_SPEED) {
+      double speed = speed_frames * FRAME_PERIOD * 1e6 / (now - speed_start);
+      fprintf(stderr, "Speed: %.2fx (%.0f fps)\n", speed,
+              speed * 1000.0 / FRAME_PERIOD);
+    }
+    speed_start = now;
+    speed_frames = 0;
+  }
+  PROFILE_FRAME();
+}
+
+// the real machine advances one frame without drawing, then the shadow copy
+// picks up from there and runs ahead, drawing only the frame that is shown.
+// the shadow's state is thrown away and overwritten again next frame. on
+// skipped frames the shadow does not run and keeps the last shown screen
+void Gameboy::run_ahead_frame(bool draw) {
+  // the real machine never draws, its vblank would export and capture a
+  // blank screen. the frame goes out below with the shadow's screen instead
+  gpu.set_exporter(NULL);
+  gpu.set_capture(NULL);
+  run_frame(false);
+  gpu.set_exporter(exporter.get());
+  gpu.set_capture(capture.get());
+  if (draw) {
+    {
+      PROFILE_ZONE(ZONE_STATE);
+      save_state(run_ahead_state);
+      run_ahead_shadow->load_state(run_ahead_state.data(),
+                                   run_ahead_state.size());
+    }
+    for (int i = 0; i < run_ahead; i++) {
+      run_ahead_shadow->run_frame(i == run_ahead - 1);
+    }
+  }
+  if (exporter) {
+    // still one slot per emulated frame, with the real machine's ram and
+    // buttons and the screen that is shown
+    exporter->publish(run_ahead_shadow->get_screen(), draw);
+  }
+  if (capture) {
+    capture->push(run_ahead_shadow->get_screen());
+  }
+}
+
+void Gameboy::set_vsync_lock(bool enabled) { vsync_lock = enabled; }
+
+void Gameboy::set_speed(double speed) { joypad.speed = speed; }
+
+void Gameboy::set_run_ahead(int frames) {
+  run_ahead = frames;
+  if (run_ahead > 0 && !run_ahead_shadow) {
+    run_ahead_shadow = fork();
+    if (display) {
+      run_ahead_shadow->gpu.set_mailbox(&display->frames);
+    }
+  }
+}
+
+// emulates one frame as fast as possible (no input polling or pacing). the
+// frame ends where the ppu enters vblank, so every line of the frame it
+// presents was drawn (or skipped) under this call's render flag. while the
+// lcd is off there is no vblank and the frame is its length in cycles
+void Gameboy::run_frame(bool render) {
+  gpu.set_draw_enabled(render);
   // max cycles per frame (59.7275 frames per second)
   const int CYCLES_PER_FRAME = CYCLES_PER_SECOND / 59.7275;
+  bool frame_done = false;
   // const int CYCLES_PER_FRAME = CYCLES_PER_SECOND / 59.7;
   // const int CYCLES_PER_FRAME = 70224;
 
   int cycles_this_update = 0;
   uint8_t interrupt_cycles = 0;
 
-  const uint64_t start_time = SDL_GetPerformanceCounter();
-
-  while (cycles_this_update < CYCLES_PER_FRAME) {
+  PROFILE_ZONE(ZONE_CPU);
+  while (!frame_done && cycles_this_update < CYCLES_PER_FRAME) {
     // perform a cycle
     // uint8_t cycles = interrupt_cycles;
     uint8_t cycles = interrupt_cycles;
+    MEMORY_STATS_CPU(memory_stats, true);
     if (cpu.state == RUNNING || cpu.state == BOOTING)
       cycles = cpu.fetch_and_execute();
-    else if (cpu.state == HALTED)
+    else if (cpu.state == HALTED) {
       cycles = 4; // 1 m-cycle
+      if (guest_profiler) {
+        guest_profiler->add_cycles(cycles);
+      }
+    }
     cycles_this_update += cycles;
+    if (trace) {
+      trace->advance(cycles);
+    }
+#ifdef GB_MEMORY_STATS
+    if (memory_stats) {
+      memory_stats->add_cycles(mmu.rom_bank_at(0x4000), cycles);
+    }
+#endif
+    MEMORY_STATS_CPU(memory_stats, false);
+    PROFILE_SWITCH(ZONE_TIMER);
     for (int i = 0; i < cycles; i++) {
       // update_timers
       timer.tick();
     }
     // update graphics
-    gpu.step(cycles);
+    PROFILE_SWITCH(ZONE_PPU);
+    frame_done = gpu.step(cycles);
     // do interrupts
+    PROFILE_SWITCH(ZONE_CPU);
+    MEMORY_STATS_CPU(memory_stats, true);
     if (cpu.service_interrupt()) {
       // an interrupt takes 5 m-cycles
       interrupt_cycles = 20;
     } else {
       interrupt_cycles = 0;
     }
+    MEMORY_STATS_CPU(memory_stats, false);
+  }
+}
+
+void Gameboy::set_buttons(uint8_t buttons) { joypad.set_buttons(buttons); }
+
+const uint8_t *Gameboy::get_screen() const { return gpu.get_screen(); }
+
+void Gameboy::enable_observation() {
+  if (!observation) {
+    observation = std::make_unique<Observation>();
+    observe(mmu, *observation);
+    gpu.set_observation(observation.get());
+  }
+}
+
+const Observation &Gameboy::get_observation() const { return *observation; }
+
+void Gameboy::export_shm(
+    const std::string &name,
+    const std::vector<std::pair<uint16_t, uint16_t>> &ranges) {
+  exporter = std::make_unique<ShmExporter>(name, mmu, joypad, ranges);
+  gpu.set_exporter(exporter.get());
+}
+
+void Gameboy::set_filter(upscale_filter filter) {
+  if (display) {
+    display->set_filter(filter);
   }
-  const uint64_t end_time = SDL_GetPerformanceCounter();
-  const double time_spent =
-      (double)((end_time - start_time) * 1000) /
-      SDL_GetPerformanceFrequency(); // time spent in milliseconds
+}
 
-  // 1x (normal) speed
-  // double delay = 16.7427 - time_spent;
+void Gameboy::profile_guest(const std::string &sym_file,
+                            const std::string &out_file) {
+  guest_profiler = std::make_unique<GuestProfiler>(mmu, sym_file, out_file);
+  cpu.set_guest_profiler(guest_profiler.get());
+}
 
-  // 2x (double) speed
-  // double delay = 8.37135 - time_spent;
+void Gameboy::record_trace(const std::string &file_name) {
+  trace = std::make_unique<TraceRecorder>(file_name);
+  mmu.set_trace(trace.get());
+}
 
-  // 4x (quadruple) speed
-  // double delay = 4.185675 - time_spent;
+void Gameboy::record_memory_stats(const std::string &file_name) {
+#ifdef GB_MEMORY_STATS
+  memory_stats = std::make_unique<MemoryStats>(file_name);
+  mmu.set_memory_stats(memory_stats.get());
+#else
+  (void)file_name;
+  std::cerr << "Memory stats need a build with make MEMORY_STATS=1"
+            << std::endl;
+  exit(1);
+#endif
+}
 
-  double delay = joypad.speed - time_spent;
+void Gameboy::record_coverage(const std::string &file_name) {
+#ifdef GB_COVERAGE
+  coverage_file = file_name;
+  coverage = std::make_unique<Coverage>(mmu.rom_hash(), mmu.rom_size());
+  cpu.set_coverage(coverage.get());
+#else
+  (void)file_name;
+  std::cerr << "Coverage needs a build with make COVERAGE=1" << std::endl;
+  exit(1);
+#endif
+}
 
-  if (delay > 1.0) {
-    SDL_Delay((Uint32) delay);
+void Gameboy::capture_video(const std::string &file_name) {
+  capture = std::make_unique<VideoCapture>(file_name);
+  gpu.set_capture(capture.get());
+}
+
+uint8_t Gameboy::peek_byte(uint16_t address) const {
+  return mmu.peek_byte(address);
+}
+
+void Gameboy::clear_ram() { mmu.clear_ram(); }
+
+uint64_t Gameboy::instruction_count() const { return cpu.instructions; }
+
+bool Gameboy::boot_done() const { return cpu.state != BOOTING; }
+
+void Gameboy::capture_serial() { mmu.set_serial_output(&serial); }
+
+const std::string &Gameboy::serial_output() const { return serial; }
+
+uint64_t Gameboy::breakpoint_count() const { return cpu.breakpoints; }
+
+CpuRegisters Gameboy::cpu_registers() const { return cpu.registers(); }
+
+void Gameboy::save_state(std::vector<uint8_t> &buffer) const {
+  StateWriter state(buffer);
+  state.value<uint32_t>(SAVESTATE_MAGIC);
+  state.value<uint32_t>(SAVESTATE_VERSION);
+  state.value<uint32_t>(mmu.rom_checksum());
+  state.value<uint32_t>(0); // payload size, patched below
+  mmu.save_state(state);
+  cpu.save_state(state);
+  timer.save_state(state);
+  gpu.save_state(state);
+  joypad.save_state(state);
+  state.patch_u32(12, state.size() - SAVESTATE_HEADER_SIZE);
+}
+
+bool Gameboy::load_state(const uint8_t *data, size_t size) {
+  StateReader state(data, size);
+  uint32_t magic = state.value<uint32_t>();
+  uint32_t version = state.value<uint32_t>();
+  uint32_t checksum = state.value<uint32_t>();
+  uint32_t payload_size = state.value<uint32_t>();
+  if (!state.ok() || magic != SAVESTATE_MAGIC ||
+      version != SAVESTATE_VERSION || checksum != mmu.rom_checksum() ||
+      payload_size != state.remaining()) {
+    return false;
+  }
+  mmu.load_state(state);
+  cpu.load_state(state);
+  timer.load_state(state);
+  gpu.load_state(state);
+  joypad.load_state(state);
+  return state.ok();
+}
+
+uint64_t Gameboy::state_hash() const {
+  std::vector<uint8_t> buffer;
+  save_state(buffer);
+  return fnv1a(buffer.data(), buffer.size());
+}
+
+void Gameboy::record_movie(const char *movie_file) {
+  this->movie_file = movie_file;
+  movie = std::make_unique<Movie>();
+  movie->rom_hash = mmu.rom_hash();
+  mmu.clear_ram();
+}
+
+bool Gameboy::play_movie(const char *movie_file) {
+  Movie playback;
+  if (!playback.load(movie_file)) {
+    std::cerr << "Could not read movie " << movie_file << std::endl;
+    return false;
+  }
+  if (playback.rom_hash != mmu.rom_hash()) {
+    std::cerr << "Movie was recorded with a different rom" << std::endl;
+    return false;
+  }
+  mmu.clear_ram();
+
+  const auto start_time = std::chrono::steady_clock::now();
+  for (uint32_t frame = 0; frame < playback.length(); frame++) {
+    // recording hashes after the frame's input is applied, so must this
+    joypad.set_buttons(playback.next_buttons());
+    uint64_t expected;
+    if (playback.hash_at(frame, expected) && state_hash() != expected) {
+      std::cerr << "Desync at frame " << frame << std::endl;
+      return false;
+    }
+    run_frame(false);
   }
+  const double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start_time)
+                             .count();
+  printf("Played %u frames in %.3f s (%.1f fps)\n", playback.length(),
+         seconds, playback.length() / seconds);
+#ifdef GB_OPCODE_STATS
+  cpu.opcode_stats.print();
+#endif
+  return true;
 }
@@ -1,5 +1,10 @@
 #include "gpu.hh"
 #include "constants.hh"
+#include "display.hh"
+#include "observation.hh"
+#include "shm_export.hh"
+#include "capture.hh"
+#include "profiler.hh"
 #include <algorithm>
 #include <cstdlib>
 #include <cstring>
@@ -13,17 +18,8 @@ typedef struct {
   int16_t sprite_x;
 } sprite_prio_t;
 
-uint32_t screen[SCREEN_HEIGHT][SCREEN_WIDTH];
-uint32_t colors[4] = {
-    0xFFFFFFFF, // white
-    0xAAAAAAFF, // light gray
-    0x555555FF, // dark gray
-    0x000000FF, // black
-};
-
 Gpu::Gpu(Memory &mem) : mmu(mem) {
   mode_clock = 0;
-  memset(screen, colors[0], sizeof(screen));
   // mmu.set_ppu_mode(2);
   win_enable = 0;
   sprite_enable = 0;
@@ -39,11 +35,52 @@ Gpu::Gpu(Memory &mem) : mmu(mem) {
   wx = 0;
   x_pos = 0;
   win_line = 0;
+  win_line_enable = false;
+  draw_enabled = true;
+  curr_line = 0;
+  mailbox = NULL;
+  observation = NULL;
+  exporter = NULL;
+  capture = NULL;
+}
+
+void Gpu::set_mailbox(FrameMailbox *mailbox) { this->mailbox = mailbox; }
+
+void Gpu::set_observation(Observation *observation) {
+  this->observation = observation;
+}
+
+void Gpu::set_exporter(ShmExporter *exporter) { this->exporter = exporter; }
+
+void Gpu::set_capture(VideoCapture *capture) { this->capture = capture; }
+
+// what get_screen shows until a line has been drawn
+static const uint8_t blank_screen[SCREEN_HEIGHT][SCREEN_WIDTH] = {};
+
+const uint8_t *Gpu::get_screen() const {
+  return screen ? &screen[0][0] : &blank_screen[0][0];
+}
+
+void Gpu::set_draw_enabled(bool enabled) { draw_enabled = enabled; }
+
+// everything else the ppu caches is reloaded from the registers before it is
+// used. wy is not: mode 2 compares LY against the value latched by the last
+// drawn line. the screen itself is output, not state, and is redrawn by the
+// next frame
+void Gpu::save_state(StateWriter &state) const {
+  state.value<uint16_t>(mode_clock);
+  state.value<uint8_t>(lcd_enable);
+  state.value<uint8_t>(win_line_enable);
+  state.value<uint8_t>(win_line);
+  state.value<uint8_t>(wy);
 }
 
-void Gpu::init_sdl(SDL_Renderer *r, SDL_Texture *t) {
-  this->renderer = r;
-  this->texture = t;
+void Gpu::load_state(StateReader &state) {
+  mode_clock = state.value<uint16_t>();
+  lcd_enable = state.value<uint8_t>();
+  win_line_enable = state.value<uint8_t>();
+  win_line = state.value<uint8_t>();
+  wy = state.value<uint8_t>();
 }
 
 bool Gpu::get_lcdc_bit(LCD_CONTROL_BIT bit) {
@@ -122,7 +159,7 @@ void Gpu::draw_pixel(uint8_t palette, uint8_t x, uint8_t y,
   uint8_t color_id = (((byte2 >> bit) & 1) << 1) | ((byte1 >> bit) & 1);
   uint8_t color =
       (palette >> (color_id << 1)) & 0x3; // extract the color from the palette
-  screen[curr_line][x_pos++] = colors[color];
+  screen[curr_line][x_pos++] = color;
 }
 
 // sprite_x is the pixel to draw's x position relative to the tile (affected by
@@ -143,7 +180,7 @@ void Gpu::draw_sprite_pixel(uint8_t palette, uint8_t draw_x, uint8_t draw_y,
   }
   uint8_t color =
       (palette >> (color_id << 1)) & 0x3; // extract the color from the palette
-  screen[pos_y][pos_x] = colors[color];
+  screen[pos_y][pos_x] = color;
 }
 
 void Gpu::draw_sprite(sprite_t sprite) {
@@ -178,7 +215,7 @@ void Gpu::draw_sprite(sprite_t sprite) {
     uint8_t draw_x = i;
     if (x_flip)
       draw_x = 7 - draw_x;
-    if (screen[curr_line][sprite.x + i] == colors[0] || bg_priority == 0) {
+    if (screen[curr_line][sprite.x + i] == 0 || bg_priority == 0) {
       draw_sprite_pixel(palette, draw_x, draw_y, sprite.x + i, curr_line,
                         tile_addr);
     }
@@ -224,6 +261,18 @@ void Gpu::draw_line() {
   set_lcdc_status();
   wy = mmu.read_byte(WIN_Y);
   wx = mmu.read_byte(WIN_X);
+
+  if (!draw_enabled) {
+    // the window line counter still has to advance as if it were drawn
+    if (bg_win_enable && win_enable && win_line_enable && wx < 167) {
+      win_line++;
+    }
+    return;
+  }
+
+  if (!screen) {
+    screen.reset(new uint8_t[SCREEN_HEIGHT][SCREEN_WIDTH]());
+  }
   scy = mmu.read_byte(SCY);
   scx = mmu.read_byte(SCX);
   curr_line = mmu.read_byte(LY);
@@ -261,7 +310,8 @@ void Gpu::draw_line() {
   }
 }
 
-void Gpu::step(uint8_t cycles) {
+bool Gpu::step(uint8_t cycles) {
+  bool frame_done = false;
   bool prev_lcd_enable = lcd_enable;
   set_lcdc_status();
   if (!lcd_enable) {
@@ -271,14 +321,12 @@ void Gpu::step(uint8_t cycles) {
       mmu.reset_scanline();
       win_line = 0;
       curr_line = 0;
-      for (int i = 0; i < SCREEN_HEIGHT; i++) {
-        for (int j = 0; j < SCREEN_WIDTH; j++) {
-          screen[i][j] = colors[0];
-        }
+      if (screen) {
+        memset(&screen[0][0], 0, SCREEN_WIDTH * SCREEN_HEIGHT);
       }
       render();
     }
-    return;
+    return false;
   } else if (!prev_lcd_enable) {
     mmu.check_lyc_ly();
     mmu.set_ppu_mode(2);
@@ -299,7 +347,10 @@ void Gpu::step(uint8_t cycles) {
   case 3: // DRAW
     if (mode_clock >= MODE_3_CYCLES) {
       mmu.set_ppu_mode(0);
-      draw_line();
+      {
+        PROFILE_ZONE(ZONE_DRAW);
+        draw_line();
+      }
       mode_clock -= MODE_3_CYCLES;
       if (get_stat_bit(MODE_0)) {
         mmu.request_interrupt(STAT_INTER);
@@ -310,9 +361,25 @@ void Gpu::step(uint8_t cycles) {
     if (mode_clock >= MODE_0_CYCLES) {
       mmu.inc_scanline();
       if (mmu.read_byte(LY) == SCREEN_HEIGHT) {
-        render();
+        {
+          PROFILE_ZONE(ZONE_RENDER);
+          render();
+        }
+        PROFILE_ZONE(ZONE_HOOKS);
+        if (observation != NULL) {
+          observe(mmu, *observation);
+        }
+        if (exporter != NULL) {
+          exporter->publish(get_screen(), draw_enabled);
+        }
+        // a skipped frame repeats the last drawn one, so the video keeps
+        // the emulated frame rate
+        if (capture != NULL) {
+          capture->push(get_screen());
+        }
         mmu.request_interrupt(VBLANK_INTER);
         mmu.set_ppu_mode(1);
+        frame_done = true;
         if (get_stat_bit(MODE_1)) {
           mmu.request_interrupt(STAT_INTER);
         }
@@ -339,11 +406,15 @@ void Gpu::step(uint8_t cycles) {
     }
     break;
   }
+  return frame_done;
 }
 
 void Gpu::render() {
-  SDL_UpdateTexture(texture, NULL, screen, SCREEN_WIDTH * sizeof(uint32_t));
-  SDL_RenderClear(renderer);
-  SDL_RenderCopy(renderer, texture, NULL, NULL);
-  SDL_RenderPresent(renderer);
+  // headless instances have nowhere to present to
+  if (mailbox == NULL || !draw_enabled) {
+    return;
+  }
+  // presenting happens on the display thread
+  memcpy(mailbox->back_buffer(), get_screen(), SCREEN_WIDTH * SCREEN_HEIGHT);
+  mailbox->publish();
 }
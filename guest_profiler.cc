@@ -0,0 +1,179 @@
+#include "guest_profiler.hh"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+GuestProfiler::GuestProfiler(const Memory &mmu, const std::string &sym_file,
+                             const std::string &out_file)
+    : mmu(mmu) {
+  file = fopen(out_file.c_str(), "w");
+  if (file == NULL) {
+    std::cerr << "Could not create " << out_file << std::endl;
+    exit(1);
+  }
+  load_symbols(sym_file);
+  nodes.push_back({-1, -1, 0});
+  current = 0;
+  charge = 0;
+}
+
+void GuestProfiler::load_symbols(const std::string &sym_file) {
+  std::ifstream in(sym_file);
+  if (!in) {
+    std::cerr << "No symbols in " << sym_file
+              << ", routines are named by address" << std::endl;
+    return;
+  }
+  std::vector<std::pair<uint32_t, std::string>> symbols;
+  std::string line;
+  while (std::getline(in, line)) {
+    line = line.substr(0, line.find(';'));
+    std::istringstream fields(line);
+    std::string location, name;
+    unsigned bank, address;
+    if (!(fields >> location >> name) ||
+        sscanf(location.c_str(), "%x:%x", &bank, &address) != 2 ||
+        bank > 0xFF || address > 0xFFFF) {
+      continue;
+    }
+    // local labels (Routine.loop) would split routines into pieces
+    if (name.find('.') != std::string::npos) {
+      continue;
+    }
+    symbols.emplace_back(bank << 16 | address, name);
+  }
+  std::sort(symbols.begin(), symbols.end());
+  for (const std::pair<uint32_t, std::string> &symbol : symbols) {
+    symbol_keys.push_back(symbol.first);
+    symbol_names.push_back(symbol.second);
+  }
+  std::cerr << "Loaded " << symbol_keys.size() << " symbols from " << sym_file
+            << std::endl;
+}
+
+int GuestProfiler::symbol_at(uint16_t address) {
+  uint32_t key = (uint32_t)mmu.rom_bank_at(address) << 16 | address;
+  auto next = std::upper_bound(symbol_keys.begin(), symbol_keys.end(), key);
+  if (next != symbol_keys.begin()) {
+    uint32_t found = *(next - 1);
+    // same bank and the same 16KiB window, so a wram routine is never named
+    // after the last label in rom
+    if (found >> 16 == key >> 16 && (found & 0xC000) == (address & 0xC000)) {
+      return next - 1 - symbol_keys.begin();
+    }
+  }
+
+  auto it = unnamed.find(key);
+  if (it != unnamed.end()) {
+    return it->second;
+  }
+  char name[16];
+  snprintf(name, sizeof(name), "%02X:%04X", key >> 16, address);
+  symbol_names.push_back(name);
+  unnamed[key] = symbol_names.size() - 1;
+  return symbol_names.size() - 1;
+}
+
+void GuestProfiler::push(uint16_t address, uint16_t sp) {
+  if (stack.size() >= GUEST_MAX_DEPTH) {
+    // return addresses are being dropped without rets reaching them
+    stack.clear();
+    current = 0;
+  }
+  int symbol = symbol_at(address);
+  uint64_t key = (uint64_t)current << 32 | (uint32_t)symbol;
+  auto it = children.find(key);
+  int node;
+  if (it != children.end()) {
+    node = it->second;
+  } else {
+    node = nodes.size();
+    nodes.push_back({current, symbol, 0});
+    children[key] = node;
+  }
+  stack.push_back({node, sp});
+  current = node;
+}
+
+void GuestProfiler::on_return(uint16_t sp) {
+  // frames whose return address is below this one were abandoned
+  while (!stack.empty() && stack.back().sp < sp) {
+    stack.pop_back();
+  }
+  if (!stack.empty() && stack.back().sp == sp) {
+    stack.pop_back();
+  }
+  current = stack.empty() ? 0 : stack.back().node;
+}
+
+GuestProfiler::~GuestProfiler() {
+  // children always come after their parents
+  std::vector<uint64_t> inclusive(nodes.size());
+  for (size_t i = nodes.size(); i-- > 0;) {
+    inclusive[i] += nodes[i].cycles;
+    if (nodes[i].parent >= 0) {
+      inclusive[nodes[i].parent] += inclusive[i];
+    }
+  }
+  uint64_t total = inclusive[0];
+
+  std::vector<uint64_t> symbol_inclusive(symbol_names.size() + 1);
+  std::vector<uint64_t> symbol_exclusive(symbol_names.size() + 1);
+  for (size_t i = 0; i < nodes.size(); i++) {
+    // the root is counted under the extra last slot
+    int symbol = nodes[i].symbol >= 0 ? nodes[i].symbol : symbol_names.size();
+    symbol_exclusive[symbol] += nodes[i].cycles;
+    // recursion would otherwise count the same cycles again
+    bool nested = false;
+    for (int p = nodes[i].parent; p >= 0 && !nested; p = nodes[p].parent) {
+      nested = nodes[p].symbol == nodes[i].symbol;
+    }
+    if (!nested) {
+      symbol_inclusive[symbol] += inclusive[i];
+    }
+
+    if (nodes[i].cycles == 0) {
+      continue;
+    }
+    std::vector<int> path;
+    for (int n = i; n > 0; n = nodes[n].parent) {
+      path.push_back(nodes[n].symbol);
+    }
+    std::string stack_line = path.empty() ? "(root)" : "";
+    for (size_t j = path.size(); j-- > 0;) {
+      stack_line += symbol_names[path[j]];
+      if (j > 0) {
+        stack_line += ';';
+      }
+    }
+    fprintf(file, "%s %llu\n", stack_line.c_str(),
+            (unsigned long long)nodes[i].cycles);
+  }
+  fclose(file);
+
+  if (total == 0) {
+    return;
+  }
+  std::vector<int> order;
+  for (size_t symbol = 0; symbol < symbol_inclusive.size(); symbol++) {
+    if (symbol_inclusive[symbol] > 0) {
+      order.push_back(symbol);
+    }
+  }
+  std::sort(order.begin(), order.end(), [&](int a, int b) {
+    return symbol_inclusive[a] > symbol_inclusive[b];
+  });
+  fprintf(stderr, "Guest profile over %llu cycles, %zu call paths\n"
+                  "  %9s %9s  %s\n",
+          (unsigned long long)total, nodes.size(), "inclusive", "exclusive",
+          "routine");
+  for (size_t i = 0; i < order.size() && i < GUEST_REPORT_ROWS; i++) {
+    int symbol = order[i];
+    fprintf(stderr, "  %8.2f%% %8.2f%%  %s\n",
+            100.0 * symbol_inclusive[symbol] / total,
+            100.0 * symbol_exclusive[symbol] / total,
+            (size_t)symbol < symbol_names.size() ? symbol_names[symbol].c_str()
+                                                 : "(root)");
+  }
+}
@@ -0,0 +1,65 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include "gpu.hh"
+#include "savestate.hh"
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define CAPTURE_SLOTS (16)             // frames waiting to be encoded
+#define CAPTURE_WRITE_SIZE (1 << 20)   // bytes buffered per write
+#define CAPTURE_KEYFRAME_INTERVAL (300) // frames
+#define CAPTURE_MAGIC (0x44564247)     // "GBVD"
+#define CAPTURE_VERSION (1)
+
+// records every emulated frame to a file on a worker thread, so the video
+// runs at the game's 59.7275 fps; frames skipped by frame skipping repeat
+// the last drawn one. push only copies the frame into a free slot; when the
+// worker falls behind the frame is dropped and counted, emulation never
+// waits for the disk.
+//
+// files ending in .y4m are uncompressed grayscale YUV4MPEG2 that ffmpeg and
+// most players read directly. anything else gets the compact format:
+//   magic, version, width, height (u32 each), the rgba palette (4 u32), then
+//   per frame a type byte (0 keyframe, 1 delta) and the frame's shades xor
+//   the previous frame's (zeros for a keyframe), run length encoded as
+//   (varint run length, value) pairs
+class VideoCapture {
+  std::vector<uint8_t> slots[CAPTURE_SLOTS];
+  std::vector<int> free_slots;
+  std::vector<int> ready_slots;
+
+  // worker only
+  FILE *file;
+  bool y4m;
+  std::vector<uint8_t> previous;
+  std::vector<uint8_t> out;
+  StateWriter writer; // appends to out
+  uint64_t encoded;
+
+  uint64_t captured;
+  uint64_t dropped;
+  std::mutex lock;
+  std::condition_variable work_ready;
+  bool shutdown;
+  std::thread worker;
+
+  void worker_loop();
+  void encode(const std::vector<uint8_t> &frame);
+  void flush();
+
+public:
+  // exits if the file cannot be created
+  VideoCapture(const std::string &file_name);
+  // encodes what is still queued and closes the file
+  ~VideoCapture();
+  void push(const uint8_t *screen);
+  uint64_t frames_dropped();
+};
+
+#endif
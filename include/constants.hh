@@ -10,6 +10,10 @@
 #define TMA_REG (0xFF06) // address of the value to reset the timer to
 #define TAC_REG (0xFF07) // address of the frequency of the timer
 
+// serial port
+#define SB_REG (0xFF01) // byte being shifted out / in
+#define SC_REG (0xFF02) // transfer start (bit 7) and clock select (bit 0)
+
 // interrupt registers
 #define IF_REG (0xFF0F)
 #define IE_REG (0xFFFF)
@@ -49,9 +53,11 @@
 #define UNUSABLE_START (0xFEA0)
 #define UNUSABLE_END (0xFEFF)
 
-// speeds
-#define NORMAL_SPEED (16.7427)
-#define DOUBLE_SPEED (8.37135)
-#define QUADRUPLE_SPEED (4.185675)
+// speeds, as multiples of the real hardware
+#define FRAME_PERIOD (16.7427) // ms per frame at normal speed (59.7275hz)
+#define NORMAL_SPEED (1.0)
+#define DOUBLE_SPEED (2.0)
+#define QUADRUPLE_SPEED (4.0)
+#define UNCAPPED_SPEED (0.0) // as fast as the host allows
 
 #endif
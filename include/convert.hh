@@ -0,0 +1,18 @@
+#ifndef CONVERT_H
+#define CONVERT_H
+
+#include <cstddef>
+#include <cstdint>
+
+// the ppu writes one shade (0 white to 3 black, after BGP/OBP0/OBP1) per
+// pixel. these turn shades into colors at the point where a frame leaves the
+// emulator, so copies and hashes of frames only move a byte per pixel
+
+extern const uint32_t dmg_palette_rgba[4]; // SDL_PIXELFORMAT_RGBA8888
+
+// count pixels from src to dst. palette maps a shade to an output pixel. uses
+// SSSE3 when the cpu has it
+void shades_to_rgba(const uint8_t *src, uint32_t *dst, size_t count,
+                    const uint32_t palette[4]);
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef COVERAGE_H
+#define COVERAGE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define COVERAGE_MAGIC (0x56434247) // "GBCV"
+#define COVERAGE_VERSION (1)
+#define COVERAGE_RAM_SIZE (0x8000) // 0x8000-0xFFFF, for code run from ram
+
+enum coverage_kind {
+  COVERAGE_OPCODE,  // first byte of an executed instruction
+  COVERAGE_OPERAND, // any later byte of one (incl. the second of 0xCB xx)
+  NUM_COVERAGE_KINDS
+};
+
+// which bytes of a game the cpu has executed, one bit per byte and kind.
+// rom bytes are identified by their offset in the rom file (bank * 0x4000 +
+// address within the bank), code running from ram by its address. the cpu
+// only marks bytes when built with make COVERAGE=1 (which defines
+// GB_COVERAGE), and never while the boot rom is mapped.
+//
+// files hold one session and are merged by or-ing them, which is
+// associative, so runs from many machines can be combined in any order.
+// layout (little endian): magic, version (u32), rom hash (u64), rom size
+// (u32), then the opcode and the operand bitmaps, each (rom size + 0x8000)
+// bits rounded up to whole bytes, lowest bit first
+class Coverage {
+  std::vector<uint8_t> bits[NUM_COVERAGE_KINDS];
+
+public:
+  uint64_t rom_hash;
+  uint32_t rom_size;
+
+  // an empty map that takes its rom from the first file merged into it
+  Coverage();
+  Coverage(uint64_t rom_hash, uint32_t rom_size);
+
+  // bank is the rom bank mapped at address (0 outside 0x4000-0x7FFF)
+  void mark(coverage_kind kind, uint8_t bank, uint16_t address) {
+    uint32_t location;
+    if (address < 0x8000) {
+      location = (uint32_t)bank * 0x4000 + (address & 0x3FFF);
+      if (location >= rom_size) {
+        return;
+      }
+    } else {
+      location = rom_size + address - 0x8000;
+    }
+    bits[kind][location >> 3] |= 1 << (location & 7);
+  }
+  bool is_marked(coverage_kind kind, uint32_t rom_offset) const;
+
+  // ors in a file written by save. returns false, leaving the map as it
+  // was, if the file cannot be read or belongs to a different rom
+  bool merge(const std::string &file_name);
+  bool save(const std::string &file_name) const;
+  // bytes covered over the whole rom and per bank, to stderr
+  void print() const;
+};
+
+#endif
@@ -1,8 +1,11 @@
 #ifndef CPU_H
 #define CPU_H
+#include <array>
 #include <cstdint>
-#include <functional>
+#include "coverage.hh"
 #include "memory.hh"
+#include "opcode_stats.hh"
+#include "savestate.hh"
 
 // flags (F register)
 #define FLAG_Z (7) // zero flag
@@ -49,6 +52,14 @@ typedef enum {
 //   std::function<void()> execute_function;
 // } Instruction;
 
+class GuestProfiler;
+
+// a copy of the register file, e.g. for test roms that report through it
+struct CpuRegisters {
+  uint8_t a, f, b, c, d, e, h, l;
+  uint16_t sp, pc;
+};
+
 union reg_t{
   unsigned short reg;
   struct {
@@ -62,8 +73,11 @@ private:
 
   Memory& mmu;
   
-  std::array<std::function<void()>, 256> opcode_table{};
-  std::array<std::function<void()>, 256> prefix_table{};
+  // one entry per opcode, shared by every instance (see cpu_table.cc)
+  typedef void (*instruction_t)(Cpu &);
+  typedef std::array<instruction_t, 256> instruction_table;
+  static const instruction_table opcode_table;
+  static const instruction_table prefix_table;
 
   // first letter is high and second is low (little endian)
   // e.g. for AF, the higher half is A and the lower half is F
@@ -82,9 +96,18 @@ private:
   bool is_prefix; // set by prefix instruction opcode 0xCB
   uint8_t instr_cycles; // m-cycles of the last executed instruction
   bool halt_bug;
+  GuestProfiler *guest_profiler; // sees calls and returns, NULL if unused
+  Coverage *coverage; // marked in GB_COVERAGE builds, NULL if unused
+#ifdef GB_COVERAGE
+  void cover(coverage_kind kind, uint16_t address) {
+    if (coverage != NULL && state != BOOTING) {
+      coverage->mark(kind, mmu.rom_bank_at(address), address);
+    }
+  }
+#endif
   
-  void init_opcode_table();
-  void init_prefix_table();
+  static instruction_table init_opcode_table();
+  static instruction_table init_prefix_table();
 
   unsigned char *find_r8(REGISTER);
   unsigned short *find_r16(REGISTER);
@@ -246,9 +269,21 @@ public:
   // use default destructor
   uint8_t fetch_and_execute();
   CPU_STATE state;
+  uint64_t instructions; // executed since power on, not part of savestates
+  // LD B,B executed since power on, which test roms use as a breakpoint. not
+  // part of savestates
+  uint64_t breakpoints;
+#ifdef GB_OPCODE_STATS
+  OpcodeStats opcode_stats;
+#endif
   bool ime; // ime (interrupt) flag
   // interrupt handling
   bool service_interrupt();
+  void set_guest_profiler(GuestProfiler *profiler);
+  void set_coverage(Coverage *coverage);
+  CpuRegisters registers() const;
+  void save_state(StateWriter &state) const;
+  void load_state(StateReader &state);
 };
 
 #endif
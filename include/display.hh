@@ -0,0 +1,82 @@
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+#include "gpu.hh"
+#include "pacer.hh"
+#include "upscale.hh"
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_events.h>
+#include <SDL2/SDL_render.h>
+#include <SDL2/SDL_video.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#define INPUT_QUEUE_SIZE (64) // power of two
+
+// triple buffer between the emulation thread (producer) and the display
+// thread (consumer). the producer draws into its back buffer and swaps it with
+// the middle one, the consumer swaps the middle one with its front buffer when
+// it holds a newer frame. neither side ever waits for the other; frames the
+// display has no time for are simply overwritten
+class FrameMailbox {
+  static const uint8_t FRESH = 4; // set in middle when it holds an unseen frame
+
+  uint8_t buffers[3][SCREEN_HEIGHT * SCREEN_WIDTH]; // shades
+  std::atomic<uint8_t> middle;
+  uint8_t back;  // producer only
+  uint8_t front; // consumer only
+
+public:
+  FrameMailbox();
+  uint8_t *back_buffer();
+  void publish();
+  // the newest published frame, or NULL if nothing new arrived since the last
+  // call
+  const uint8_t *take();
+};
+
+// single producer, single consumer ring of SDL events going from the display
+// thread to the emulation thread. events are dropped if it is full
+class InputQueue {
+  SDL_Event events[INPUT_QUEUE_SIZE];
+  std::atomic<uint32_t> head; // next slot to write
+  std::atomic<uint32_t> tail; // next slot to read
+
+public:
+  InputQueue();
+  bool push(const SDL_Event &event);
+  bool pop(SDL_Event &event);
+};
+
+// owns SDL and presents frames on the main thread while the emulation runs on
+// its own thread, so driver stalls and vsync waits never hold up the cpu
+class Display {
+  SDL_Window *window;
+  SDL_Renderer *renderer;
+  SDL_Texture *texture;
+  std::atomic<bool> closed;
+  std::atomic<int64_t> last_present; // monotonic ns, 0 before the first one
+  std::atomic<int64_t> refresh_period; // ns, measured from presents
+  std::unique_ptr<Upscaler> upscaler; // NULL leaves scaling to the gpu
+
+  void init_sdl();
+  void shutdown_sdl();
+  void create_texture(int scale);
+
+public:
+  FrameMailbox frames;
+  InputQueue input;
+
+  Display();
+  ~Display();
+  // presents frames and forwards input until close is called
+  void run();
+  void close();
+  // call before run
+  void set_filter(upscale_filter filter);
+  int64_t vsync_time() const;
+  int64_t vsync_period() const;
+};
+
+#endif
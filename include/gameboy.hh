@@ -1,11 +1,22 @@
 #ifndef GAMEBOY_H
 #define GAMEBOY_H
 
+#include "capture.hh"
 #include "cpu.hh"
+#include "display.hh"
 #include "gpu.hh"
+#include "guest_profiler.hh"
 #include "joypad.hh"
 #include "memory.hh"
+#include "memory_stats.hh"
+#include "metrics.hh"
+#include "movie.hh"
+#include "observation.hh"
+#include "pacer.hh"
+#include "rewind.hh"
+#include "shm_export.hh"
 #include "timer.hh"
+#include "trace.hh"
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_log.h>
 #include <SDL2/SDL_render.h>
@@ -18,19 +29,133 @@ class Gameboy {
   Gpu gpu;
   Timer timer;
   Joypad joypad;
+  std::unique_ptr<RewindBuffer> rewind_buffer; // only used by start
+  std::unique_ptr<Movie> movie; // set while recording
+  std::string movie_file;
 
-  // SDL
-  SDL_Window *window;
-  SDL_Renderer *renderer;
-  SDL_Texture *texture;
-  void init_sdl();
-  void shutdown_sdl();
+  // run-ahead: the frame shown comes from a second instance emulated this many
+  // frames past the real one with the current input
+  int run_ahead;
+  std::unique_ptr<Gameboy> run_ahead_shadow;
+  std::vector<uint8_t> run_ahead_state;
+  void run_ahead_frame(bool draw);
+
+  std::unique_ptr<Display> display; // NULL when headless
+  std::unique_ptr<Observation> observation; // see enable_observation
+  std::unique_ptr<ShmExporter> exporter;    // see export_shm
+  std::unique_ptr<VideoCapture> capture;    // see capture_video
+  std::unique_ptr<GuestProfiler> guest_profiler; // see profile_guest
+  std::unique_ptr<TraceRecorder> trace;          // see record_trace
+  std::unique_ptr<MemoryStats> memory_stats;     // see record_memory_stats
+  std::unique_ptr<Coverage> coverage;            // see record_coverage
+  std::string coverage_file;
+  std::string serial; // sent over the link port, see capture_serial
+  FramePacer pacer;
+  bool vsync_lock;
+  int64_t last_drawn; // when the last displayed frame was emulated
+  int64_t last_frame_end; // for the frame time metrics, 0 at first
+
+  // achieved speed, printed once a second while not at normal speed
+  int64_t speed_start;
+  uint32_t speed_frames;
+  void emulate();
+
+  // used by fork
+  Gameboy(const Gameboy &parent);
 
 public:
-  Gameboy(char *rom_file);
-  // default destructor
+  // headless instances never touch SDL and are driven through run_frame
+  Gameboy(char *rom_file, bool headless = false);
+  ~Gameboy();
+  // runs the emulation on a second thread while the calling thread presents
+  // frames, until the window is closed
   void start();
   void update();
+  // runs up to the start of the next vblank, so the screen afterwards is
+  // the frame just finished. render = false keeps the ppu's timing,
+  // registers and interrupts exact but skips generating pixels, leaving the
+  // screen as the last rendered frame
+  void run_frame(bool render = true);
+  void set_buttons(uint8_t buttons);
+  // one shade (0-3) per pixel, see convert.hh for turning it into colors
+  const uint8_t *get_screen() const;
+  // from then on the tiles and sprites on screen are recorded at every vblank
+  // (see observation.hh), which works whether frames are rendered or not
+  void enable_observation();
+  const Observation &get_observation() const;
+  // publishes every frame, the buttons and the given (start, length) ram
+  // ranges to other processes through shared memory (see shm_export.hh).
+  // with run-ahead the real machine does not render, so only the ram and
+  // buttons are current
+  void export_shm(const std::string &name,
+                  const std::vector<std::pair<uint16_t, uint16_t>> &ranges);
+  // cpu side upscaling before frames are shown (see upscale.hh)
+  void set_filter(upscale_filter filter);
+  // records every emulated frame to a video file (see capture.hh)
+  void capture_video(const std::string &file_name);
+  // attributes emulated cycles to the game's routines named in sym_file and
+  // writes them as collapsed stacks to out_file when the machine is
+  // destroyed (see guest_profiler.hh). run-ahead copies are not profiled
+  void profile_guest(const std::string &sym_file, const std::string &out_file);
+  // writes a timeline of hardware events (ppu modes, interrupts, halts,
+  // dma, bank switches, lcd on/off, timer overflows) as a Chrome trace
+  // (see trace.hh). run-ahead copies are not traced
+  void record_trace(const std::string &file_name);
+  // counts the cpu's reads, writes and fetches per 16 byte line and the rom
+  // banks' switches and mapped time, written to file_name when the machine
+  // is destroyed (see memory_stats.hh). needs a build with make
+  // MEMORY_STATS=1, exits otherwise
+  void record_memory_stats(const std::string &file_name);
+  // marks every rom byte the cpu executes (see coverage.hh) and saves the
+  // bitmap to file_name when the machine is destroyed. needs a build with
+  // make COVERAGE=1, exits otherwise
+  void record_coverage(const std::string &file_name);
+  uint8_t peek_byte(uint16_t address) const;
+  // empties the cartridge ram, so runs do not depend on a battery save
+  void clear_ram();
+
+  // for benchmarks: instructions executed since power on, and whether the
+  // boot rom has handed over to the cartridge yet
+  uint64_t instruction_count() const;
+  bool boot_done() const;
+
+  // for test roms: what they print over the serial port from then on,
+  // which is only kept after capture_serial, how many times they have hit
+  // the LD B,B breakpoint and the registers they leave their result in
+  void capture_serial();
+  const std::string &serial_output() const;
+  uint64_t breakpoint_count() const;
+  CpuRegisters cpu_registers() const;
+
+  // savestates (see savestate.hh for the layout). load_state returns false
+  // and leaves the machine untouched if the buffer is not a savestate of
+  // this rom in the current format
+  void save_state(std::vector<uint8_t> &buffer) const;
+  bool load_state(const uint8_t *data, size_t size);
+
+  // a headless copy of the machine that shares memory pages with this one
+  // until either side writes to them, so forks that only diverge in a few
+  // bytes stay cheap
+  std::unique_ptr<Gameboy> fork() const;
+
+  // hash of the full machine state
+  uint64_t state_hash() const;
+
+  // movies. recording captures the input of every frame played through start
+  // and is written when the window closes. playback runs a movie headless as
+  // fast as possible and returns false on a desync. both start from power on
+  // with empty cartridge ram and leave the battery save alone
+  void record_movie(const char *movie_file);
+  bool play_movie(const char *movie_file);
+
+  // 0 turns run-ahead off
+  void set_run_ahead(int frames);
+  // paces frames to the display's refresh rate when it is close enough to
+  // the game boy's (see FramePacer::lock_to_vsync)
+  void set_vsync_lock(bool enabled);
+  // multiple of the real hardware's speed, UNCAPPED_SPEED runs as fast as
+  // possible. frames the display has no time for are emulated without drawing
+  void set_speed(double speed);
 };
 
 #endif
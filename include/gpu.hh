@@ -2,12 +2,16 @@
 #define GPU_H
 
 #include "memory.hh"
-#include <SDL2/SDL.h>
-#include <SDL2/SDL_render.h>
-#include <SDL2/SDL_video.h>
+#include "savestate.hh"
 #include <cstdint>
+#include <memory>
 
 // bits for the LCD control register
+class FrameMailbox;
+struct Observation;
+class ShmExporter;
+class VideoCapture;
+
 typedef enum {
   BG_WIN_ENABLE = 0,
   OBJ_ENABLE = 1,
@@ -57,7 +61,10 @@ class Gpu {
   uint16_t tile_data_base;
   uint8_t sprite_height;
   bool win_line_enable;
-  // uint8_t screen[SCREEN_HEIGHT][SCREEN_WIDTH];
+  bool draw_enabled; // false skips pixel work and presenting, timing is kept
+  // shades, see convert.hh. allocated by the first drawn line, so instances
+  // that never draw (e.g. forks that only search) do not carry one
+  std::unique_ptr<uint8_t[][SCREEN_WIDTH]> screen;
 
   // registers
   uint8_t curr_line;
@@ -83,22 +90,33 @@ class Gpu {
   void draw_sprite_tile_line(int16_t, int16_t, int16_t, uint8_t, uint8_t);
   // void set_draw_color(uint8_t);
   void set_lcdc_status();
-  void draw_line();
   void set_mode(uint8_t);
   // void render_sprite_tile_debug(uint8_t);
 
-  // SDL
-  // SDL_Window *window;
-  SDL_Renderer *renderer;
-  SDL_Texture *texture;
+  FrameMailbox *mailbox; // where finished frames go, NULL when headless
+  Observation *observation; // refreshed at every vblank, NULL if unused
+  ShmExporter *exporter;    // gets every frame at vblank, NULL if unused
+  VideoCapture *capture;    // gets every frame at vblank, NULL if unused
 
 public:
   Gpu(Memory &mem);
   // use default destructor
-  void step(uint8_t);
+  // true when the step finished a frame, i.e. entered vblank
+  bool step(uint8_t);
+  // draws the line LY points at into the screen. step calls it at the end of
+  // mode 3; it is public for benchmarks
+  void draw_line();
   void render();
   bool is_lcd_enabled();
-  void init_sdl(SDL_Renderer *, SDL_Texture *);
+  void set_mailbox(FrameMailbox *mailbox);
+  void set_observation(Observation *observation);
+  void set_exporter(ShmExporter *exporter);
+  void set_capture(VideoCapture *capture);
+  // blank until something has been drawn
+  const uint8_t *get_screen() const;
+  void set_draw_enabled(bool enabled);
+  void save_state(StateWriter &state) const;
+  void load_state(StateReader &state);
 };
 
 #endif
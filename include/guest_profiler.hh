@@ -0,0 +1,82 @@
+#ifndef GUEST_PROFILER_H
+#define GUEST_PROFILER_H
+
+#include "memory.hh"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define GUEST_REPORT_ROWS (30) // routines listed on stderr
+#define GUEST_MAX_DEPTH (256)  // deeper stacks are assumed lost and reset
+
+// attributes emulated cycles to the game's own routines. calls, rsts and
+// interrupt dispatch push a frame on a shadow call stack, rets and retis pop
+// it, and every instruction's cycles go to the frame it started in. frames
+// are named after the nearest global label at or below their entry address
+// from an RGBDS / no$gmb .sym file ("bank:address name" per line), or the
+// address itself when there is none.
+//
+// each frame remembers the stack pointer its return address lives at, so
+// routines that drop their return address and jump elsewhere are unwound on
+// the next ret that reaches further up the stack.
+//
+// the result is written as collapsed stacks ("root;caller;callee cycles" per
+// line, exclusive cycles), which flamegraph.pl, speedscope and inferno read,
+// plus a table of inclusive and exclusive cycles per routine on stderr
+class GuestProfiler {
+  // one per distinct call path
+  struct Node {
+    int parent;
+    int symbol;
+    uint64_t cycles; // exclusive
+  };
+  struct Frame {
+    int node;
+    uint16_t sp; // where the frame's return address lives
+  };
+
+  const Memory &mmu;
+  FILE *file;
+
+  std::vector<uint32_t> symbol_keys; // bank << 16 | address, sorted
+  std::vector<std::string> symbol_names; // ids index the two above first
+  std::unordered_map<uint32_t, int> unnamed; // key to id, for addresses
+
+  std::vector<Node> nodes; // 0 is the root
+  std::unordered_map<uint64_t, int> children; // parent << 32 | symbol
+  std::vector<Frame> stack;
+  int current; // node on top of the stack, the root when it is empty
+  int charge; // the frame the running instruction started in
+
+  void load_symbols(const std::string &sym_file);
+  int symbol_at(uint16_t address);
+  void push(uint16_t address, uint16_t sp);
+
+public:
+  // exits if out_file cannot be created; a missing sym_file only means
+  // frames are named by address
+  GuestProfiler(const Memory &mmu, const std::string &sym_file,
+                const std::string &out_file);
+  // writes the collapsed stacks and prints the table
+  ~GuestProfiler();
+
+  // sp is where the return address was pushed
+  void on_call(uint16_t target, uint16_t sp) { push(target, sp); }
+  // unlike a call, an interrupt happens between instructions, so the next
+  // cycles already belong to the handler
+  void on_interrupt(uint16_t handler, uint16_t sp) {
+    push(handler, sp);
+    charge = current;
+  }
+  // sp is where the return address is about to be popped from
+  void on_return(uint16_t sp);
+  // after each instruction (or halted step)
+  void add_cycles(uint32_t cycles) {
+    nodes[charge].cycles += cycles;
+    charge = current;
+  }
+};
+
+#endif
@@ -3,6 +3,7 @@
 
 #include "stdint.h"
 #include "memory.hh"
+#include "savestate.hh"
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_events.h>
 #include <SDL2/SDL_keycode.h>
@@ -21,8 +22,11 @@ typedef enum {
 } keys;
 
 
+class InputQueue;
+
 class Joypad {
   Memory &mmu;
+  InputQueue *input; // events forwarded by the display thread
 
   uint8_t key_state; // standard buttons in lower nibble, directional in upper nibble
   uint8_t joypad;
@@ -30,11 +34,18 @@ class Joypad {
   void key_released(uint8_t key);
 public:
   bool quit;
-  double speed;
+  bool rewinding; // rewind key held
+  double speed; // multiple of real time, UNCAPPED_SPEED for no limit
   Joypad(Memory &m);
   void set_joypad_state(uint8_t joypad_state);
   uint8_t get_joypad_state();
+  uint8_t peek_joypad_state() const;
+  void set_buttons(uint8_t buttons);
+  uint8_t get_buttons() const;
+  void set_input_queue(InputQueue *input);
   void handle_input();
+  void save_state(StateWriter &state) const;
+  void load_state(StateReader &state);
 };
 
 #endif
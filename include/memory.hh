@@ -1,8 +1,11 @@
 #ifndef MEMORY_H
 #define MEMORY_H
 
+#include <array>
 #include <cstdint>
+#include <memory>
 #include <string>
+#include "savestate.hh"
 
 enum banking_types {
   MBC1,
@@ -22,13 +25,28 @@ enum ram_sizes {
   EIGHT_BANKS = 65536,
 };
 
+#define MEM_PAGE_SIZE (0x100)
+#define RAM_BANKS_SIZE (0x8000) // a ram bank is 0x2000 in size and there are 4 max
+
+typedef std::array<uint8_t, MEM_PAGE_SIZE> page_t;
+
 class Timer;
 class Joypad;
 class Cpu;
+class TraceRecorder;
+class MemoryStats;
 
 class Memory {
 private:
   std::string file_name;
+  std::shared_ptr<unsigned char[]> cart; // shared between instances of a rom
+  // the address space and the ram banks are split into pages that forked
+  // instances share until one of them writes to a page (copy on write).
+  // mem_data holds the page pointers used for access; echo ram entries point
+  // at the wram pages and have no owner of their own in mem_pages
+  std::shared_ptr<page_t> mem_pages[0x100];
+  uint8_t *mem_data[0x100];
+  std::shared_ptr<page_t> ram_pages[RAM_BANKS_SIZE / MEM_PAGE_SIZE];
   unsigned char num_rom_banks; // rom banks are 16KiB in size
   uint32_t ram_size;
   enum banking_types banking_type;
@@ -39,6 +57,9 @@ private:
   Timer *timer;
   Joypad *joypad;
   Cpu *cpu;
+  TraceRecorder *trace; // NULL unless tracing
+  MemoryStats *memory_stats; // NULL unless counting, see set_memory_stats
+  std::string *serial_output; // bytes sent over the link port, may be NULL
 
   uint8_t mbc_read(unsigned short address) const;
   void mbc_write(unsigned short address, unsigned char data);
@@ -51,15 +72,27 @@ private:
   uint8_t mbc3_read(uint16_t address) const;
   void mbc3_write(uint16_t address, uint8_t data);
 
-  
+  void init();
+  bool has_save_file() const;
+  uint32_t save_size() const;
+  uint8_t mem_read(uint16_t address) const;
+  uint8_t &mem_ref(uint16_t address);
+  uint8_t ram_read(uint32_t offset) const;
+  uint8_t &ram_ref(uint32_t offset);
+  void copy_from_ram(uint8_t *dst, uint32_t size) const;
+  void copy_to_ram(const uint8_t *src, uint32_t size);
 
 public:
   Memory(char *rom_file);
+  // a rom image that is already in memory (e.g. a synthetic one for
+  // benchmarks); it has no save file
+  Memory(const uint8_t *rom, size_t size);
   // use default destructor
   
   void write_byte(unsigned short address, unsigned char data);
   unsigned char read_byte(unsigned short address) const;
   unsigned short read_word(unsigned short address) const;
+  uint8_t peek_byte(uint16_t address) const;
   void request_interrupt(uint8_t);
   void reset_scanline();
   void reset_lcd_status();
@@ -69,7 +102,28 @@ public:
   void set_timer(Timer *t);
   void set_joypad(Joypad *j);
   void set_cpu(Cpu *cpu);
+  // hardware events of this machine go to trace (see trace.hh), NULL stops
+  void set_trace(TraceRecorder *trace);
+  TraceRecorder *get_trace() const;
+  // cpu accesses are counted into stats (see memory_stats.hh) in builds
+  // with GB_MEMORY_STATS, NULL stops
+  void set_memory_stats(MemoryStats *stats);
+  // every byte the game sends over the serial port is appended to output
+  void set_serial_output(std::string *output);
+#ifdef GB_MEMORY_STATS
+  // the cpu starts an instruction at address
+  void count_fetch(uint16_t address);
+#endif
   int save_ram();
+  uint32_t rom_checksum() const;
+  uint64_t rom_hash() const;
+  uint32_t rom_size() const;
+  void clear_ram();
+  void save_state(StateWriter &state) const;
+  void load_state(StateReader &state);
+
+  // the rom bank mapped at address, 0 outside the switchable bank
+  uint8_t rom_bank_at(uint16_t address) const;
 
   uint8_t get_ppu_mode() const;
   void set_ppu_mode(uint8_t mode);
@@ -0,0 +1,79 @@
+#ifndef MEMORY_STATS_H
+#define MEMORY_STATS_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#define MEMORY_STATS_LINE (16) // bytes per heatmap cell
+#define MEMORY_STATS_LINES (0x10000 / MEMORY_STATS_LINE)
+#define MEMORY_STATS_BANKS (0x100)
+#define MEMORY_STATS_MAGIC (0x4D484247) // "GBHM"
+#define MEMORY_STATS_VERSION (1)
+#define MEMORY_REPORT_ROWS (20) // hottest lines and busiest banks on stderr
+
+enum memory_access {
+  ACCESS_READ,  // every cpu read, instruction bytes and oam dma included
+  ACCESS_WRITE,
+  ACCESS_FETCH, // the first byte of each executed instruction
+  NUM_ACCESSES
+};
+
+// how the game uses the address space: cpu reads, writes and instruction
+// fetches per 16 byte line of the bus, and per rom bank how often it was
+// switched in, how many cycles it stayed mapped and how often it was read.
+// the ppu's own reads are not counted. an oam dma started by the cpu counts
+// its 160 source bytes as cpu reads. memory and the cpu only count when
+// built with make MEMORY_STATS=1 (which defines GB_MEMORY_STATS), so normal
+// builds pay nothing.
+//
+// the binary heatmap is little endian: magic, version, line size, line
+// count (u32 each), then reads, writes and fetches per line, then per bank
+// switches, cycles and reads (u64 each). a summary goes to stderr
+class MemoryStats {
+  uint64_t lines[NUM_ACCESSES][MEMORY_STATS_LINES];
+  uint64_t bank_switches[MEMORY_STATS_BANKS]; // times the bank was switched in
+  uint64_t bank_cycles[MEMORY_STATS_BANKS];   // t-cycles it was mapped
+  uint64_t bank_reads[MEMORY_STATS_BANKS];    // reads of 0x4000-0x7FFF
+  FILE *file;
+
+  void print() const;
+
+public:
+  // set by the emulation loop while the cpu runs, so ppu reads are skipped
+  bool cpu_access;
+
+  // exits if the file cannot be created
+  MemoryStats(const std::string &file_name);
+  // writes the heatmap and prints the summary
+  ~MemoryStats();
+
+  // bank is the rom bank mapped at address (0 outside 0x4000-0x7FFF)
+  void count(memory_access access, uint16_t address, uint8_t bank) {
+    lines[access][address / MEMORY_STATS_LINE]++;
+    if (access == ACCESS_READ && address >= 0x4000 && address < 0x8000) {
+      bank_reads[bank]++;
+    }
+  }
+  void bank_switch(uint8_t bank) { bank_switches[bank]++; }
+  // charges the bank mapped at 0x4000
+  void add_cycles(uint8_t bank, uint32_t cycles) {
+    bank_cycles[bank] += cycles;
+  }
+};
+
+// marks where the emulation loop hands the bus to the cpu and back
+#ifdef GB_MEMORY_STATS
+#define MEMORY_STATS_CPU(stats, on)                                           \
+  do {                                                                        \
+    if (stats) {                                                              \
+      (stats)->cpu_access = (on);                                             \
+    }                                                                         \
+  } while (0)
+#else
+#define MEMORY_STATS_CPU(stats, on)                                           \
+  do {                                                                        \
+  } while (0)
+#endif
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#define METRICS_INTERVAL_MS (5000) // how often the file is rewritten
+#define METRICS_BUCKETS (12)       // frame time buckets, the last is +Inf
+
+// process wide health counters. the emulation threads only do relaxed
+// atomic adds, a publisher thread reads them and never takes a lock the
+// emulation waits on
+struct Metrics {
+  std::atomic<int64_t> instances;
+  std::atomic<uint64_t> frames;
+  // wall time from the end of one frame to the end of the next
+  std::atomic<uint64_t> frame_buckets[METRICS_BUCKETS];
+  std::atomic<uint64_t> frame_ns;
+  // frames whose emulation took longer than their slot at the current speed
+  std::atomic<uint64_t> frames_over_budget;
+  // how late the pacer woke after a deadline it waited for
+  std::atomic<uint64_t> overshoot_ns;
+  std::atomic<uint64_t> overshoots;
+  std::atomic<uint64_t> overshoot_max_ns; // since the last publish
+  // frames that reached the pacer after their deadline, and by how much
+  std::atomic<uint64_t> late_ns;
+  std::atomic<uint64_t> late_frames;
+  // battery save writes
+  std::atomic<uint64_t> save_ns;
+  std::atomic<uint64_t> saves;
+  std::atomic<uint64_t> save_last_ns;
+
+  // frame_ns is the frame's wall time, busy_ns the part before pacing,
+  // budget_ns the frame period at the current speed (0 when uncapped)
+  void frame(int64_t frame_ns, int64_t busy_ns, int64_t budget_ns);
+  void overshoot(int64_t ns);
+  void late(int64_t ns);
+  void save(int64_t ns);
+};
+
+extern Metrics metrics;
+
+// upper bounds of the frame time buckets in microseconds
+extern const int64_t metrics_bucket_us[METRICS_BUCKETS - 1];
+
+inline void Metrics::frame(int64_t frame_ns, int64_t busy_ns,
+                           int64_t budget_ns) {
+  frames.fetch_add(1, std::memory_order_relaxed);
+  this->frame_ns.fetch_add(frame_ns, std::memory_order_relaxed);
+  int bucket = 0;
+  while (bucket < METRICS_BUCKETS - 1 &&
+         frame_ns > metrics_bucket_us[bucket] * 1000) {
+    bucket++;
+  }
+  frame_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+  if (budget_ns > 0 && busy_ns > budget_ns) {
+    frames_over_budget.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+inline void Metrics::overshoot(int64_t ns) {
+  overshoot_ns.fetch_add(ns, std::memory_order_relaxed);
+  overshoots.fetch_add(1, std::memory_order_relaxed);
+  uint64_t max = overshoot_max_ns.load(std::memory_order_relaxed);
+  while ((uint64_t)ns > max &&
+         !overshoot_max_ns.compare_exchange_weak(max, ns,
+                                                 std::memory_order_relaxed)) {
+  }
+}
+
+inline void Metrics::late(int64_t ns) {
+  late_ns.fetch_add(ns, std::memory_order_relaxed);
+  late_frames.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline void Metrics::save(int64_t ns) {
+  save_ns.fetch_add(ns, std::memory_order_relaxed);
+  saves.fetch_add(1, std::memory_order_relaxed);
+  save_last_ns.store(ns, std::memory_order_relaxed);
+}
+
+// rewrites a Prometheus text exposition file every METRICS_INTERVAL_MS, for
+// node_exporter's textfile collector or anything else that scrapes files.
+// the file is written next to its final name and renamed over it, so a
+// reader never sees half of it. rates (fps, real-time factor) and frame
+// time quantiles cover the last interval, counters the whole process
+class MetricsPublisher {
+  std::string file_name;
+  std::string temp_name;
+
+  // publisher only
+  int64_t last_time;
+  uint64_t last_frames;
+  uint64_t last_buckets[METRICS_BUCKETS];
+
+  std::mutex lock;
+  std::condition_variable wake;
+  bool shutdown;
+  std::thread worker;
+
+  void worker_loop();
+  void publish();
+
+public:
+  // exits if the file cannot be written
+  MetricsPublisher(const std::string &file_name);
+  // publishes once more, so writes made while shutting down are included
+  ~MetricsPublisher();
+};
+
+#endif
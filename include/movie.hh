@@ -0,0 +1,51 @@
+#ifndef MOVIE_H
+#define MOVIE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// movie file layout (all integers little endian):
+//   magic, version, rom hash (u64), frame count, hash interval, run count,
+//   hash count, then the input runs as (varint frame count, button mask) and
+//   the state hashes (u64). a state hash is taken before every
+//   MOVIE_HASH_INTERVAL-th frame so a replay can tell where it went wrong
+#define MOVIE_MAGIC (0x564D4247) // "GBMV"
+#define MOVIE_VERSION (1)
+#define MOVIE_HASH_INTERVAL (60)
+
+// the joypad state of every frame since power on, run length encoded
+class Movie {
+  std::vector<std::pair<uint32_t, uint8_t>> runs; // (frames, buttons)
+  std::vector<uint64_t> hashes;
+  uint32_t frames;
+  uint32_t hash_interval;
+
+  // playback position
+  size_t run;
+  uint32_t run_frame;
+
+public:
+  uint64_t rom_hash;
+
+  Movie();
+  // appends one frame of input
+  void record(uint8_t buttons);
+  // appends the state hash taken before a hash frame (see is_hash_frame)
+  void record_hash(uint64_t state_hash);
+  bool is_hash_frame(uint32_t frame) const;
+  uint32_t length() const;
+
+  // buttons for the next frame of playback
+  uint8_t next_buttons();
+  // the hash recorded for frame, false if it is not a hash frame or the
+  // movie has none for it
+  bool hash_at(uint32_t frame, uint64_t &state_hash) const;
+
+  bool save(const std::string &movie_file) const;
+  bool load(const std::string &movie_file);
+};
+
+#endif
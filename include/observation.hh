@@ -0,0 +1,37 @@
+#ifndef OBSERVATION_H
+#define OBSERVATION_H
+
+#include "gpu.hh"
+#include "memory.hh"
+#include <cstdint>
+
+#define OBS_WIDTH (SCREEN_WIDTH / 8)   // tiles
+#define OBS_HEIGHT (SCREEN_HEIGHT / 8) // tiles
+#define OBS_MAX_SPRITES (40)
+#define OBS_NO_TILE (0xFFFF) // background and window are off
+
+// what is on screen as tiles instead of pixels, taken at the start of vblank.
+// a few hundred bytes per frame against 23 KB of framebuffer. vram and oam
+// are read with peek_byte, so the ppu's access blocking does not blank them
+struct Observation {
+  // tile number in vram (0-383, as 0x8000 + tile * 16) under the top left
+  // pixel of each 8x8 cell of the screen, after scrolling. the window covers
+  // the background where it is enabled
+  uint16_t tiles[OBS_HEIGHT][OBS_WIDTH];
+  // visible sprites in oam order with their screen position. tall sprites
+  // keep their even tile number
+  sprite_t sprites[OBS_MAX_SPRITES];
+  uint8_t num_sprites;
+  // registers the tiles were read with, scx & 7 and scy & 7 give the fine
+  // scroll of the grid
+  uint8_t lcdc;
+  uint8_t scx;
+  uint8_t scy;
+  uint8_t wx;
+  uint8_t wy;
+};
+
+// fills the observation from vram, oam and the lcd registers
+void observe(const Memory &mmu, Observation &obs);
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef OPCODE_STATS_H
+#define OPCODE_STATS_H
+
+#include <cstdint>
+#include <unordered_map>
+
+#define OPCODE_STATS_SIZE (0x200)     // opcodes, then cb prefixed ones
+#define OPCODE_SAMPLE_INTERVAL (61)   // instructions between pc samples
+#define OPCODE_REPORT_ROWS (40)       // per table
+
+// what the interpreter spends its time on: executions and cycles per opcode
+// and a histogram of sampled (rom bank, pc) pairs, which finds each rom's hot
+// loops. the cpu only keeps one when built with make OPCODE_STATS=1 (which
+// defines GB_OPCODE_STATS), so normal builds pay nothing. the interval is
+// prime so samples do not lock onto loops of a fixed length
+class OpcodeStats {
+  uint64_t counts[OPCODE_STATS_SIZE];
+  uint64_t cycles[OPCODE_STATS_SIZE]; // t-cycles
+  std::unordered_map<uint32_t, uint64_t> pc_samples; // bank << 16 | pc
+  uint32_t until_sample;
+
+public:
+  OpcodeStats();
+  // index is the opcode, or 0x100 + the second byte for 0xCB prefixed ones.
+  // bank is the rom bank the pc was in (0 outside 0x4000-0x7FFF)
+  void count(uint16_t index, uint8_t t_cycles, uint8_t bank, uint16_t pc) {
+    counts[index]++;
+    cycles[index] += t_cycles;
+    if (--until_sample == 0) {
+      until_sample = OPCODE_SAMPLE_INTERVAL;
+      pc_samples[(uint32_t)bank << 16 | pc]++;
+    }
+  }
+  // the most executed opcodes, the most expensive ones and the hottest
+  // addresses, to stderr
+  void print() const;
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef PACER_H
+#define PACER_H
+
+#include <cstdint>
+#include <ctime>
+#include <vector>
+
+#define PACER_SPIN_NS (500000)      // last stretch before a deadline is spun
+#define PACER_MAX_LAG_NS (100000000) // further behind than this, stop catching up
+#define PACER_SAMPLES (3600)        // frame times kept for the report
+#define VSYNC_LOCK_TOLERANCE (0.02) // max rate difference vsync lock bridges
+
+inline int64_t monotonic_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// what one wait found: either the frame was early and the pacer waited for
+// its deadline, waking overshoot_ns after it, or the frame was already
+// late_ns behind schedule and it returned at once
+struct PacerWait {
+  bool waited;
+  int64_t overshoot_ns;
+  int64_t late_ns;
+};
+
+// paces frames against an absolute schedule of deadlines, so a late frame
+// shortens the next wait instead of pushing every later frame back. waits
+// sleep until shortly before the deadline and spin the rest, since the
+// scheduler routinely wakes sleepers a few hundred microseconds late
+class FramePacer {
+  int64_t period;   // ns between deadlines
+  int64_t deadline; // 0 until the first frame
+  int64_t last_frame;
+
+  // vsync lock, see lock_to_vsync
+  bool vsync_locked;
+  int64_t vsync_time;
+  int64_t vsync_period;
+
+  std::vector<int64_t> frame_times; // ring of the latest PACER_SAMPLES
+  size_t next_sample;
+
+public:
+  FramePacer();
+  void set_period(double period_ms);
+  // forgets the schedule, e.g. after running unpaced
+  void reset();
+  // when the display refreshes at nearly the emulated rate (60 Hz against
+  // 59.7275 Hz), runs at the display's rate instead and keeps the deadlines
+  // half a refresh away from the last present, so every refresh shows
+  // exactly one new frame. the emulation runs that fraction of a percent
+  // faster or slower than the real hardware
+  void lock_to_vsync(int64_t vsync_time, int64_t vsync_period);
+  // blocks until the next frame is due
+  PacerWait wait();
+  // frame time and jitter percentiles over the latest frames, to stderr
+  void print_stats() const;
+};
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "pacer.hh"
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+// time stamp counter cycles, which tick at a fixed reference rate
+inline uint64_t read_ticks() { return __rdtsc(); }
+#define TICK_UNIT "cycles"
+#else
+inline uint64_t read_ticks() { return monotonic_ns(); }
+#define TICK_UNIT "ns"
+#endif
+
+// where host time goes, split by subsystem. build with make PROFILE=1 (which
+// defines GB_PROFILE) to get a line on stderr every second with the time
+// per emulated frame spent in each zone; otherwise every PROFILE_ macro
+// compiles to nothing.
+//
+// zones are exclusive: entering one stops the clock of the zone it is nested
+// in, so the emulation thread's zones add up to its wall time and draw_line
+// is not also counted as ppu. the display thread is reported on its own
+enum profile_zone {
+  ZONE_OTHER, // outside every zone
+  ZONE_CPU,   // instructions and interrupt dispatch
+  ZONE_TIMER,
+  ZONE_PPU,    // Gpu::step minus the zones below
+  ZONE_DRAW,   // Gpu::draw_line
+  ZONE_RENDER, // handing the frame to the display
+  ZONE_HOOKS,  // observation, shared memory export and capture at vblank
+  ZONE_INPUT,
+  ZONE_REWIND, // rewind buffer and movie recording
+  ZONE_STATE,  // run-ahead savestates
+  ZONE_SLEEP,  // frame pacing
+  ZONE_UPLOAD, // display thread: shades to texture, incl. upscaling
+  ZONE_PRESENT, // display thread: clear, copy and present (waits for vsync)
+  ZONE_POLL,    // display thread: events and waiting for frames
+  NUM_ZONES
+};
+
+#ifdef GB_PROFILE
+
+struct ProfileThread {
+  uint64_t ticks[NUM_ZONES];
+  uint64_t last; // when the current zone's clock last started, 0 at first
+  profile_zone current;
+};
+
+extern thread_local ProfileThread profile_thread;
+
+inline void profile_switch(profile_zone zone) {
+  uint64_t now = read_ticks();
+  if (profile_thread.last != 0) {
+    profile_thread.ticks[profile_thread.current] += now - profile_thread.last;
+  }
+  profile_thread.last = now;
+  profile_thread.current = zone;
+}
+
+class ProfileScope {
+  profile_zone parent;
+
+public:
+  ProfileScope(profile_zone zone) {
+    parent = profile_thread.current;
+    profile_switch(zone);
+  }
+  ~ProfileScope() { profile_switch(parent); }
+};
+
+// adds the calling thread's zones to the totals
+void profile_flush();
+// called by the emulation thread after every frame; flushes and prints the
+// report once a second
+void profile_frame();
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_ZONE(zone)                                                     \
+  ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(zone)
+// moves the clock to another zone without nesting, for back to back phases
+// inside a PROFILE_ZONE, which still returns to its parent when it ends
+#define PROFILE_SWITCH(zone) profile_switch(zone)
+#define PROFILE_FLUSH() profile_flush()
+#define PROFILE_FRAME() profile_frame()
+
+#else
+
+#define PROFILE_ZONE(zone)
+#define PROFILE_SWITCH(zone)
+#define PROFILE_FLUSH()
+#define PROFILE_FRAME()
+
+#endif
+
+#endif
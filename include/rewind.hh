@@ -0,0 +1,83 @@
+#ifndef REWIND_H
+#define REWIND_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class Gameboy;
+
+#define REWIND_CAPACITY (600)          // frames (10 seconds)
+#define REWIND_KEYFRAME_INTERVAL (60)  // frames between full snapshots
+#define REWIND_PENDING_SLOTS (4)       // snapshots waiting to be compressed
+
+// bounded history of per-frame savestates for rewinding. every
+// REWIND_KEYFRAME_INTERVAL frames a full snapshot is kept; the frames in
+// between only store the xor against that keyframe, run length encoded, which
+// is mostly zeros. push only copies the raw state into a free slot, the
+// compression happens on a worker thread. if the worker falls behind the frame
+// is dropped rather than stalling emulation
+class RewindBuffer {
+
+  struct Entry {
+    uint64_t frame;
+    uint64_t keyframe; // frame of the keyframe this is a delta against
+    bool is_keyframe;
+    int key_slot;              // index into keyframes, -1 for a delta
+    std::vector<uint8_t> data; // the delta, empty for a keyframe
+  };
+
+  // ring of compressed history, oldest at tail
+  std::vector<Entry> entries;
+  size_t head;
+  size_t count;
+
+  // full snapshots live apart from the deltas, so a ring entry never ends up
+  // holding a keyframe sized buffer for a delta
+  std::vector<std::vector<uint8_t>> keyframes;
+  std::vector<int> free_keyframes;
+
+  // raw snapshots handed from push to the worker
+  std::vector<uint8_t> slots[REWIND_PENDING_SLOTS];
+  uint64_t slot_frame[REWIND_PENDING_SLOTS];
+  std::vector<int> free_slots;
+  std::vector<int> ready_slots;
+
+  // worker-only encoding state
+  std::vector<uint8_t> keyframe;
+  uint64_t keyframe_frame;
+
+  bool force_keyframe; // set by rewind, the history was cut short
+
+  std::vector<uint8_t> scratch; // decoded state for rewind
+  uint64_t frame;
+  uint64_t dropped;
+  bool busy; // worker is compressing a slot
+
+  std::mutex lock;
+  std::condition_variable work_ready;
+  std::condition_variable work_done;
+  bool shutdown;
+  std::thread worker;
+
+  void worker_loop();
+  Entry &insert();
+  void evict_oldest();
+  void release(Entry &entry);
+  const Entry *find_keyframe(const Entry &entry) const;
+
+public:
+  RewindBuffer();
+  ~RewindBuffer();
+
+  // snapshots the machine at the start of a frame
+  void push(const Gameboy &gameboy);
+  // restores the most recent snapshot and forgets it. returns false once the
+  // history is exhausted
+  bool rewind(Gameboy &gameboy);
+  size_t size();
+};
+
+#endif
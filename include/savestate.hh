@@ -0,0 +1,74 @@
+#ifndef SAVESTATE_H
+#define SAVESTATE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// savestate layout (all integers little endian):
+//   magic, version, rom checksum, payload size, then the payload written by
+//   Memory, Cpu, Timer, Gpu and Joypad in that order. the buffer holds no
+//   pointers so it can be copied, stored or sent anywhere
+#define SAVESTATE_MAGIC (0x54534247) // "GBST"
+#define SAVESTATE_VERSION (3)
+#define SAVESTATE_HEADER_SIZE (16)
+
+// appends to a caller-owned buffer. the buffer is cleared but keeps its
+// capacity, so saving repeatedly into the same buffer does not allocate
+class StateWriter {
+  std::vector<uint8_t> &buffer;
+
+public:
+  StateWriter(std::vector<uint8_t> &buffer);
+  void write(const void *data, size_t size);
+  void patch_u32(size_t offset, uint32_t value);
+  // 7 bits per byte, lowest first, the top bit set on all but the last
+  void varint(uint32_t value);
+  size_t size() const;
+
+  template <typename T> void value(T v) {
+    uint8_t bytes[sizeof(T)];
+    for (size_t i = 0; i < sizeof(T); i++) {
+      bytes[i] = (uint64_t)v >> (i * 8);
+    }
+    write(bytes, sizeof(T));
+  }
+};
+
+// reads back from a buffer without copying it. reading past the end leaves
+// the destination zeroed and marks the reader as failed
+class StateReader {
+  const uint8_t *data;
+  size_t size;
+  size_t pos;
+  bool failed;
+
+public:
+  StateReader(const uint8_t *data, size_t size);
+  void read(void *dst, size_t size);
+  // fails on more than the 5 bytes a u32 needs
+  uint32_t varint();
+  size_t remaining() const;
+  bool ok() const;
+
+  template <typename T> T value() {
+    uint8_t bytes[sizeof(T)];
+    read(bytes, sizeof(T));
+    uint64_t v = 0;
+    for (size_t i = 0; i < sizeof(T); i++) {
+      v |= (uint64_t)bytes[i] << (i * 8);
+    }
+    return (T)v;
+  }
+};
+
+// 64 bit FNV-1a, for state, rom and screen hashes
+inline uint64_t fnv1a(const uint8_t *data, size_t size,
+                      uint64_t hash = 0xCBF29CE484222325ULL) {
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ data[i]) * 0x100000001B3ULL;
+  }
+  return hash;
+}
+
+#endif
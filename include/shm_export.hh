@@ -0,0 +1,75 @@
+#ifndef SHM_EXPORT_H
+#define SHM_EXPORT_H
+
+#include "gpu.hh"
+#include "joypad.hh"
+#include "memory.hh"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// shared memory layout: a ShmHeader, then SHM_SLOTS slots of slot_size bytes,
+// each a ShmSlot followed by ram_size bytes of the exported ram ranges in
+// order. frame n goes into slot n % SHM_SLOTS. a slot's seq is odd while it
+// is being written and 2 * (frame + 1) once it is complete, so a reader
+// takes the slot of latest, reads seq, uses the slot in place and checks seq
+// again afterwards; if it changed the writer lapped it and it retries with
+// the new latest. the writer never waits for readers
+#define SHM_MAGIC (0x48534247) // "GBSH"
+#define SHM_VERSION (1)
+#define SHM_SLOTS (8)
+#define SHM_MAX_RANGES (16)
+
+struct ShmRange {
+  uint16_t start;
+  uint16_t length;
+};
+
+struct ShmHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t slots;
+  uint32_t slot_size;
+  uint32_t ram_size;
+  uint32_t num_ranges;
+  ShmRange ranges[SHM_MAX_RANGES];
+  alignas(64) std::atomic<uint64_t> latest; // newest complete frame + 1, 0 = none
+};
+
+struct alignas(64) ShmSlot {
+  std::atomic<uint64_t> seq;
+  uint64_t frame;
+  uint8_t buttons;  // see Joypad::set_buttons
+  uint8_t rendered; // 0 if the screen was not redrawn this frame
+  uint8_t screen[SCREEN_HEIGHT * SCREEN_WIDTH]; // shades, see convert.hh
+};
+
+// publishes every finished frame into a POSIX shared memory object for other
+// processes. the object is removed again when the exporter is destroyed
+class ShmExporter {
+  std::string name;
+  const Memory &mmu;
+  const Joypad &joypad;
+  std::vector<ShmRange> ranges;
+  uint32_t ram_size;
+  size_t slot_size;
+  size_t map_size;
+  uint8_t *map;
+  ShmHeader *header;
+  uint64_t frame;
+
+  ShmSlot *slot(uint64_t frame);
+
+public:
+  // name is a shm_open name such as "/gb-emu". ranges are (start, length)
+  // pairs of addresses read with Memory::peek_byte, so exporting has no side
+  // effects. exits if the object cannot be created
+  ShmExporter(const std::string &name, const Memory &mmu, const Joypad &joypad,
+              const std::vector<std::pair<uint16_t, uint16_t>> &ranges);
+  ~ShmExporter();
+  void publish(const uint8_t *screen, bool rendered);
+};
+
+#endif
@@ -3,6 +3,7 @@
 
 #include <cstdint>
 #include "memory.hh"
+#include "savestate.hh"
 
 class Timer {
   uint16_t div;
@@ -25,6 +26,8 @@ public:
   uint8_t timer_read(uint16_t reg);
   void timer_write(uint16_t reg, uint8_t data);
   void tick();
+  void save_state(StateWriter &state) const;
+  void load_state(StateReader &state);
 };
 
 #endif
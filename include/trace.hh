@@ -0,0 +1,98 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#define TRACE_RING_SIZE (1 << 16)    // events, a power of two
+#define TRACE_DRAIN_INTERVAL_MS (10)  // how often the writer empties the ring
+#define TRACE_WRITE_SIZE (1 << 20)    // bytes buffered per write
+
+enum trace_event_type : uint8_t {
+  TRACE_PPU_MODE,          // arg: the mode entered
+  TRACE_INTERRUPT_REQUEST, // arg: interrupt bit
+  TRACE_INTERRUPT_SERVICE, // arg: interrupt bit
+  TRACE_HALT_ENTER,
+  TRACE_HALT_EXIT,
+  TRACE_DMA,     // arg: source page
+  TRACE_ROM_BANK, // arg: bank now at 0x4000
+  TRACE_RAM_BANK, // arg: bank now at 0xA000
+  TRACE_LCD_ON,
+  TRACE_LCD_OFF,
+  TRACE_TIMER_OVERFLOW,
+};
+
+struct TraceEvent {
+  uint64_t cycle;
+  trace_event_type type;
+  uint8_t arg;
+};
+
+// timeline of emulated hardware events, stamped with the emulated cycle
+// count, written as Chrome trace event JSON (chrome://tracing, Perfetto's
+// ui.perfetto.dev). record only stores the event in a single producer,
+// single consumer ring; a writer thread drains it every few milliseconds and
+// does all the formatting, so tracing can stay on for whole sessions. if
+// the writer falls behind, events are dropped and counted rather than
+// stalling emulation.
+//
+// ppu modes and halts become slices, everything else instant events, each
+// kind on its own track
+class TraceRecorder {
+  TraceEvent ring[TRACE_RING_SIZE];
+  alignas(64) std::atomic<uint64_t> head; // next slot the producer fills
+  alignas(64) std::atomic<uint64_t> tail; // next slot the writer reads
+
+  // emulation thread only
+  alignas(64) uint64_t now;
+  uint64_t tail_seen;
+  uint64_t dropped;
+
+  // writer only
+  FILE *file;
+  std::string out;
+  uint64_t written;
+  bool lcd_on;
+  uint8_t mode;
+  uint64_t mode_start;
+  bool halted;
+  uint64_t halt_start;
+  uint64_t last_cycle;
+
+  std::atomic<bool> shutdown;
+  std::thread writer;
+
+  void writer_loop();
+  void drain();
+  void write_event(const TraceEvent &event);
+  void slice(const char *name, int track, uint64_t start, uint64_t end);
+  void instant(const char *name, int track, uint64_t cycle);
+  void flush();
+
+public:
+  // exits if the file cannot be created
+  TraceRecorder(const std::string &file_name);
+  // writes what is still queued and closes the json
+  ~TraceRecorder();
+
+  // the emulation loop moves the clock after every instruction
+  void advance(uint32_t cycles) { now += cycles; }
+
+  void record(trace_event_type type, uint8_t arg = 0) {
+    uint64_t h = head.load(std::memory_order_relaxed);
+    if (h - tail_seen >= TRACE_RING_SIZE) {
+      tail_seen = tail.load(std::memory_order_acquire);
+      if (h - tail_seen >= TRACE_RING_SIZE) {
+        dropped++;
+        return;
+      }
+    }
+    ring[h & (TRACE_RING_SIZE - 1)] = {now, type, arg};
+    head.store(h + 1, std::memory_order_release);
+  }
+};
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef UPSCALE_H
+#define UPSCALE_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+enum upscale_filter {
+  FILTER_NONE,    // the gpu scales with nearest neighbour
+  FILTER_SCALE2X, // AdvMAME2x
+  FILTER_SCALE3X, // AdvMAME3x
+};
+
+#define UPSCALE_SAMPLES (3600) // frame costs kept for the report
+
+// pixel art upscaling of a frame of shades into rgba on the cpu. the rows are
+// split into one band per thread; the calling thread takes the first band and
+// a pool of workers the others. each band scales its rows and converts them
+// straight into the destination
+class Upscaler {
+  upscale_filter filter;
+  int scale;
+
+  // the frame being scaled
+  const uint8_t *frame;
+  uint32_t *dst;
+  int pitch; // bytes
+
+  std::vector<std::thread> workers;
+  int num_bands;
+  std::mutex lock;
+  std::condition_variable frame_start;
+  std::condition_variable frame_done;
+  uint64_t generation;
+  int bands_left;
+  bool shutdown;
+
+  std::vector<int64_t> costs; // ns per frame, ring of the latest
+  size_t next_cost;
+
+  void worker_loop(int band);
+  void run_band(int band);
+
+public:
+  // num_threads = 0 uses every core
+  Upscaler(upscale_filter filter, int num_threads = 0);
+  ~Upscaler();
+  int get_scale() const;
+  // scales a SCREEN_WIDTH x SCREEN_HEIGHT frame of shades into dst, which
+  // holds get_scale() times as many rows and columns of pitch bytes each
+  void run(const uint8_t *frame, uint32_t *dst, int pitch);
+  // per frame cost percentiles, to stderr
+  void print_stats() const;
+};
+
+#endif
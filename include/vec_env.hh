@@ -0,0 +1,75 @@
+#ifndef VEC_ENV_H
+#define VEC_ENV_H
+
+#include "gameboy.hh"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// steps many headless instances of the same rom in lock step. every call to
+// step advances each instance by the same number of frames, spread across a
+// pool of worker threads. instances are handed out one at a time from
+// per-worker queues and idle workers steal from the others, since frames can
+// differ a lot in cost between games (and between points in the same game)
+class VecEnv {
+
+  // a contiguous run of instances owned by one worker. next is claimed with
+  // fetch_add by the owner and by thieves alike
+  struct alignas(64) WorkQueue {
+    std::atomic<int> next;
+    int end;
+  };
+
+  std::vector<std::unique_ptr<Gameboy>> envs;
+  std::vector<uint16_t> ram_addresses;
+
+  std::vector<std::thread> workers;
+  std::unique_ptr<WorkQueue[]> queues;
+  int num_queues;
+
+  // the batch currently being stepped
+  const uint8_t *actions;
+  int repeat;
+  uint8_t *frames_out;
+  uint8_t *ram_out;
+  Observation *obs_out;
+
+  std::mutex lock;
+  std::condition_variable batch_start;
+  std::condition_variable batch_done;
+  uint64_t generation;
+  int workers_busy;
+  bool shutdown;
+
+  void worker_loop(int id);
+  void run_queues(int id);
+  void step_env(int index);
+
+public:
+  // num_threads = 0 uses every core
+  VecEnv(char *rom_file, int num_envs, int num_threads = 0);
+  ~VecEnv();
+
+  int size() const;
+  Gameboy &env(int index);
+
+  // ram bytes copied out for every instance after each step, in this order
+  void set_ram_addresses(const std::vector<uint16_t> &addresses);
+
+  // actions holds one button mask per instance (see Joypad::set_buttons),
+  // held for repeat frames. frames_out receives size() * 160 * 144 shades
+  // (see convert.hh) and ram_out size() * ram addresses bytes; either may be
+  // NULL. nothing is allocated here so the caller can reuse the same arrays
+  // every batch. pixels are only rendered for steps with a frames_out, so
+  // passing one every k-th step is how to observe every k-th step at a
+  // fraction of the cost. obs_out, if given, receives size() tile
+  // observations from the last vblank
+  void step(const uint8_t *actions, int repeat, uint8_t *frames_out,
+            uint8_t *ram_out, Observation *obs_out = NULL);
+};
+
+#endif
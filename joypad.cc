@@ -2,11 +2,14 @@
 #include "SDL2/SDL_events.h"
 #include "SDL2/SDL_keycode.h"
 #include "constants.hh"
+#include "display.hh"
 
 Joypad::Joypad(Memory &m) : mmu(m) {
   key_state = 0xFF;
   joypad = 0xFF;
+  input = NULL;
   quit = false;
+  rewinding = false;
   speed = NORMAL_SPEED;
 }
 
@@ -39,9 +42,41 @@ uint8_t Joypad::get_joypad_state() {
   return joypad;
 }
 
+// same value as get_joypad_state but without latching it or raising the
+// joypad interrupt
+uint8_t Joypad::peek_joypad_state() const {
+  if (((joypad >> 4) & 1) == 0) {
+    return (joypad & 0xF0) | (key_state >> 4);
+  } else if (((joypad >> 5) & 1) == 0) {
+    return (joypad & 0xF0) | (key_state & 0x0F);
+  }
+  return joypad;
+}
+
+// replaces the whole key state at once. a set bit in buttons means the key
+// (bit positions from the keys enum) is held down
+void Joypad::set_buttons(uint8_t buttons) { key_state = ~buttons; }
+
+uint8_t Joypad::get_buttons() const { return ~key_state; }
+
+void Joypad::save_state(StateWriter &state) const {
+  state.value<uint8_t>(key_state);
+  state.value<uint8_t>(joypad);
+}
+
+void Joypad::load_state(StateReader &state) {
+  key_state = state.value<uint8_t>();
+  joypad = state.value<uint8_t>();
+}
+
+void Joypad::set_input_queue(InputQueue *input) { this->input = input; }
+
 void Joypad::handle_input() {
+  if (input == NULL) {
+    return;
+  }
   SDL_Event event;
-  while (SDL_PollEvent(&event)) {
+  while (input->pop(event)) {
     if (event.type == SDL_QUIT) {
       quit = true;
       return;
@@ -52,8 +87,12 @@ void Joypad::handle_input() {
       case SDLK_c:
           if (speed == NORMAL_SPEED) speed = DOUBLE_SPEED;
           else if (speed == DOUBLE_SPEED) speed = QUADRUPLE_SPEED;
+          else if (speed == QUADRUPLE_SPEED) speed = UNCAPPED_SPEED;
           else speed = NORMAL_SPEED;
           break;
+      case SDLK_r:
+        rewinding = true;
+        break;
       case SDLK_UP:
         key_pressed(KEY_UP);
         break;
@@ -83,6 +122,9 @@ void Joypad::handle_input() {
       }
     } else if (event.type == SDL_KEYUP) {
       switch (event.key.keysym.sym) {
+      case SDLK_r:
+        rewinding = false;
+        break;
       case SDLK_UP:
         key_released(KEY_UP);
         break;
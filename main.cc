@@ -1,13 +1,176 @@
+#include "constants.hh"
 #include "gameboy.hh"
 #include <stdio.h>
+#include <string.h>
+
+static void usage() {
+  printf("Usage: gameboy [--record movie | --play movie] [--run-ahead frames] "
+         "[--vsync] [--speed factor] [--shm name [--shm-ram start:length]...] "
+         "[--capture video] [--filter none|scale2x|scale3x] "
+         "[--profile-guest out.folded [--sym file.sym]] [--trace trace.json] "
+         "[--metrics file.prom] [--heatmap file] [--coverage file] "
+         "[path/to/rom]\n"
+         "       gameboy --merge-coverage out in...\n");
+  exit(1);
+}
 
 int main(int argc, char *argv[]) {
-  if (argc != 2) {
-    printf("Usage: gameboy [path/to/rom]\n");
-    exit(1);
+  char *rom_file = NULL;
+  char *record_file = NULL;
+  char *play_file = NULL;
+  int run_ahead = 0;
+  bool vsync = false;
+  double speed = NORMAL_SPEED;
+  char *shm_name = NULL;
+  char *capture_file = NULL;
+  char *profile_file = NULL;
+  char *sym_file = NULL;
+  char *trace_file = NULL;
+  char *metrics_file = NULL;
+  char *heatmap_file = NULL;
+  char *coverage_file = NULL;
+  upscale_filter filter = FILTER_NONE;
+  std::vector<std::pair<uint16_t, uint16_t>> shm_ranges;
+  // or-s coverage files of the same rom, e.g. from many automated runs
+  if (argc >= 4 && strcmp(argv[1], "--merge-coverage") == 0) {
+    Coverage merged;
+    for (int i = 3; i < argc; i++) {
+      if (!merged.merge(argv[i])) {
+        fprintf(stderr, "Could not merge %s\n", argv[i]);
+        return 1;
+      }
+    }
+    if (!merged.save(argv[2])) {
+      fprintf(stderr, "Could not write %s\n", argv[2]);
+      return 1;
+    }
+    merged.print();
+    return 0;
+  }
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+      record_file = argv[++i];
+    } else if (strcmp(argv[i], "--play") == 0 && i + 1 < argc) {
+      play_file = argv[++i];
+    } else if (strcmp(argv[i], "--run-ahead") == 0 && i + 1 < argc) {
+      run_ahead = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+      speed = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+      i++;
+      if (strcmp(argv[i], "scale2x") == 0) {
+        filter = FILTER_SCALE2X;
+      } else if (strcmp(argv[i], "scale3x") == 0) {
+        filter = FILTER_SCALE3X;
+      } else if (strcmp(argv[i], "none") != 0) {
+        usage();
+      }
+    } else if (strcmp(argv[i], "--profile-guest") == 0 && i + 1 < argc) {
+      profile_file = argv[++i];
+    } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+      trace_file = argv[++i];
+    } else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+      metrics_file = argv[++i];
+    } else if (strcmp(argv[i], "--heatmap") == 0 && i + 1 < argc) {
+      heatmap_file = argv[++i];
+    } else if (strcmp(argv[i], "--coverage") == 0 && i + 1 < argc) {
+      coverage_file = argv[++i];
+    } else if (strcmp(argv[i], "--sym") == 0 && i + 1 < argc) {
+      sym_file = argv[++i];
+    } else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+      capture_file = argv[++i];
+    } else if (strcmp(argv[i], "--shm") == 0 && i + 1 < argc) {
+      shm_name = argv[++i];
+    } else if (strcmp(argv[i], "--shm-ram") == 0 && i + 1 < argc) {
+      // start:length in hex, e.g. C000:100. lengths are 16 bit, so a
+      // range covers at most 0xFFFF bytes
+      char *end;
+      unsigned long start = strtoul(argv[++i], &end, 16);
+      if (*end != ':') {
+        usage();
+      }
+      unsigned long length = strtoul(end + 1, &end, 16);
+      if (*end != '\0' || start > 0xFFFF || length == 0 || length > 0xFFFF ||
+          length > 0x10000 - start) {
+        usage();
+      }
+      shm_ranges.emplace_back(start, length);
+    } else if (strcmp(argv[i], "--vsync") == 0) {
+      vsync = true;
+    } else if (rom_file == NULL && argv[i][0] != '-') {
+      rom_file = argv[i];
+    } else {
+      usage();
+    }
+  }
+  if (rom_file == NULL || (record_file != NULL && play_file != NULL) ||
+      run_ahead < 0 || speed < 0) {
+    usage();
+  }
+
+  // rgbds names the symbols of game.gb game.sym
+  std::string sym_path;
+  if (sym_file != NULL) {
+    sym_path = sym_file;
+  } else {
+    sym_path = rom_file;
+    size_t dot = sym_path.find_last_of('.');
+    if (dot != std::string::npos &&
+        sym_path.find('/', dot) == std::string::npos) {
+      sym_path.erase(dot);
+    }
+    sym_path += ".sym";
+  }
+
+  if (play_file != NULL) {
+    Gameboy gameboy(rom_file, true);
+    if (profile_file != NULL) {
+      gameboy.profile_guest(sym_path, profile_file);
+    }
+    if (trace_file != NULL) {
+      gameboy.record_trace(trace_file);
+    }
+    if (heatmap_file != NULL) {
+      gameboy.record_memory_stats(heatmap_file);
+    }
+    if (coverage_file != NULL) {
+      gameboy.record_coverage(coverage_file);
+    }
+    return gameboy.play_movie(play_file) ? 0 : 1;
   }
 
-  Gameboy gameboy(argv[1]);
+  // outlives the machine, so the battery save written on exit is published
+  std::unique_ptr<MetricsPublisher> metrics_publisher;
+  if (metrics_file != NULL) {
+    metrics_publisher = std::make_unique<MetricsPublisher>(metrics_file);
+  }
+  Gameboy gameboy(rom_file);
+  if (profile_file != NULL) {
+    gameboy.profile_guest(sym_path, profile_file);
+  }
+  if (trace_file != NULL) {
+    gameboy.record_trace(trace_file);
+  }
+  if (heatmap_file != NULL) {
+    gameboy.record_memory_stats(heatmap_file);
+  }
+  if (coverage_file != NULL) {
+    gameboy.record_coverage(coverage_file);
+  }
+  if (record_file != NULL) {
+    gameboy.record_movie(record_file);
+  }
+  gameboy.set_run_ahead(run_ahead);
+  gameboy.set_vsync_lock(vsync);
+  gameboy.set_speed(speed);
+  gameboy.set_filter(filter);
+  if (capture_file != NULL) {
+    gameboy.capture_video(capture_file);
+  }
+  if (shm_name != NULL) {
+    gameboy.export_shm(shm_name, shm_ranges);
+  }
   gameboy.start();
   return 1;
 }
@@ -3,15 +3,29 @@
 #include "timer.hh"
 #include "joypad.hh"
 #include "cpu.hh"
+#include "metrics.hh"
+#include "pacer.hh"
+#include "memory_stats.hh"
+#include "trace.hh"
 #include <cerrno>
 #include <cstdio>
+#include <cstring>
 #include <iostream>
+#include <map>
+#include <mutex>
 #include <fcntl.h>
 #include <unistd.h>
 
-static unsigned char mem[0x10000];
-static unsigned char cart[0x200000];
-static unsigned char ram_banks[0x8000]; // a ram bank is 0x2000 in size and there are 4 max
+#define CART_SIZE (0x200000)
+
+// every page starts out pointing here and is copied on its first write
+static const std::shared_ptr<page_t> zero_page = std::make_shared<page_t>();
+
+// echo ram pages (0xE0-0xFD) alias the wram pages 0x2000 below them
+static inline uint8_t canonical_page(uint8_t page) {
+  return (page >= 0xE0 && page <= 0xFD) ? page - 0x20 : page;
+}
+
 static unsigned char boot_rom[0x100] = {
   0x31, 0xFE, 0xFF, 0xAF, 0x21, 0xFF, 0x9F, 0x32, 0xCB, 0x7C, 0x20, 0xFB, 0x21, 0x26, 0xFF, 0x0E,
   0x11, 0x3E, 0x80, 0x32, 0xE2, 0x0C, 0x3E, 0xF3, 0xE2, 0x32, 0x3E, 0x77, 0x77, 0x3E, 0xFC, 0xE0,
@@ -31,10 +45,18 @@ static unsigned char boot_rom[0x100] = {
   0xF5, 0x06, 0x19, 0x78, 0x86, 0x23, 0x05, 0x20, 0xFB, 0x86, 0x20, 0xFE, 0x3E, 0x01, 0xE0, 0x50
 };
 
-Memory::Memory(char *rom_file){
-  file_name = rom_file;
+// instances running the same rom share one read-only copy of the cartridge
+static std::shared_ptr<unsigned char[]> load_cart(const std::string &rom_file) {
+  static std::mutex cache_lock;
+  static std::map<std::string, std::weak_ptr<unsigned char[]>> cache;
 
-  FILE *rom_fp = fopen(rom_file, "rb"); // open in read binary mode
+  std::lock_guard<std::mutex> guard(cache_lock);
+  std::shared_ptr<unsigned char[]> cart = cache[rom_file].lock();
+  if (cart) {
+    return cart;
+  }
+
+  FILE *rom_fp = fopen(rom_file.c_str(), "rb"); // open in read binary mode
   if (rom_fp == NULL) {
     std::cout << "Failed to load rom with filepath " << rom_file << std::endl;
     exit(1);
@@ -43,13 +65,14 @@ Memory::Memory(char *rom_file){
   fseek(rom_fp, 0, SEEK_END);
   unsigned long fsize = ftell(rom_fp); 
   rewind(rom_fp);
-  if (fsize > sizeof(cart)) { 
+  if (fsize > CART_SIZE) { 
     std::cout << "rom is too large" << std::endl;
     fclose(rom_fp);
     rom_fp = NULL;
     exit(1);
   }
-  if (fread(cart, 1, fsize, rom_fp) != fsize) { 
+  cart.reset(new unsigned char[CART_SIZE]());
+  if (fread(cart.get(), 1, fsize, rom_fp) != fsize) { 
     std::cout << "failed to read rom contents" << std::endl;
     fclose(rom_fp);
     rom_fp = NULL;
@@ -59,6 +82,39 @@ Memory::Memory(char *rom_file){
   fclose(rom_fp);
   rom_fp = NULL;
 
+  cache[rom_file] = cart;
+  return cart;
+}
+
+Memory::Memory(char *rom_file){
+  file_name = rom_file;
+  cart = load_cart(file_name);
+  init();
+}
+
+Memory::Memory(const uint8_t *rom, size_t size) {
+  if (size > CART_SIZE) {
+    std::cout << "rom is too large" << std::endl;
+    exit(1);
+  }
+  cart.reset(new unsigned char[CART_SIZE]());
+  memcpy(cart.get(), rom, size);
+  init();
+}
+
+void Memory::init() {
+  trace = NULL;
+  memory_stats = NULL;
+  serial_output = NULL;
+  for (int page = 0; page < 0x100; page++) {
+    if (canonical_page(page) == page) {
+      mem_pages[page] = zero_page;
+    }
+    mem_data[page] = zero_page->data();
+  }
+  for (std::shared_ptr<page_t> &page : ram_pages) {
+    page = zero_page;
+  }
 
   switch(cart[0x147]) {
     case 0:
@@ -138,14 +194,15 @@ Memory::Memory(char *rom_file){
     exit(1);
   }
 
-  memset(ram_banks, 0, sizeof(ram_banks));
-  if (banking_type == MBC1_RAM_BATTERY || banking_type == MBC3_RAM_BATTERY) {
+  if (has_save_file()) {
     std::string save_file = file_name + ".sav";
     int save_fd = open(save_file.c_str(), O_RDONLY);
     if (save_fd >= 0) {
-      int bytes_read = read(save_fd, ram_banks, ram_size);
+      uint8_t ram_banks[RAM_BANKS_SIZE] = {};
+      int bytes_read = read(save_fd, ram_banks, save_size());
       close(save_fd);
-      if ((uint32_t)bytes_read != ram_size) {
+      copy_to_ram(ram_banks, save_size());
+      if ((uint32_t)bytes_read != save_size()) {
         std::cout << "Couldn't read from save file." << std::endl;
         std::cout << "Starting boot anyway." << std::endl;
       }
@@ -158,7 +215,7 @@ Memory::Memory(char *rom_file){
   mode_flag = false;
 
   // reset joypad
-  mem[0xFF00] = 0xFF;
+  mem_ref(0xFF00) = 0xFF;
 
   // special io regs
   // enable when boot is disabled
@@ -207,22 +264,96 @@ void Memory::set_cpu(Cpu *cpu) {
   this->cpu = cpu;
 }
 
+void Memory::set_trace(TraceRecorder *trace) {
+  this->trace = trace;
+}
+
+TraceRecorder *Memory::get_trace() const { return trace; }
+
+void Memory::set_memory_stats(MemoryStats *stats) { memory_stats = stats; }
+
+void Memory::set_serial_output(std::string *output) { serial_output = output; }
+
+#ifdef GB_MEMORY_STATS
+void Memory::count_fetch(uint16_t address) {
+  if (memory_stats != NULL) {
+    memory_stats->count(ACCESS_FETCH, address, rom_bank_at(address));
+  }
+}
+#endif
+
+// only 4 ram banks are backed, so larger headers are clamped
+uint32_t Memory::save_size() const {
+  return ram_size < RAM_BANKS_SIZE ? ram_size : RAM_BANKS_SIZE;
+}
+
+uint8_t Memory::mem_read(uint16_t address) const {
+  return mem_data[address >> 8][address & 0xFF];
+}
+
+// writable reference into a page, unsharing it first if a fork still uses it
+uint8_t &Memory::mem_ref(uint16_t address) {
+  uint8_t page = canonical_page(address >> 8);
+  if (mem_pages[page].use_count() > 1) {
+    mem_pages[page] = std::make_shared<page_t>(*mem_pages[page]);
+    mem_data[page] = mem_pages[page]->data();
+    if (page >= 0xC0 && page <= 0xDD) {
+      mem_data[page + 0x20] = mem_data[page];
+    }
+  }
+  return mem_data[page][address & 0xFF];
+}
+
+uint8_t Memory::ram_read(uint32_t offset) const {
+  return (*ram_pages[offset >> 8])[offset & 0xFF];
+}
+
+uint8_t &Memory::ram_ref(uint32_t offset) {
+  std::shared_ptr<page_t> &page = ram_pages[offset >> 8];
+  if (page.use_count() > 1) {
+    page = std::make_shared<page_t>(*page);
+  }
+  return (*page)[offset & 0xFF];
+}
+
+void Memory::copy_from_ram(uint8_t *dst, uint32_t size) const {
+  for (uint32_t offset = 0; offset < size; offset += MEM_PAGE_SIZE) {
+    memcpy(dst + offset, ram_pages[offset >> 8]->data(), MEM_PAGE_SIZE);
+  }
+}
+
+void Memory::copy_to_ram(const uint8_t *src, uint32_t size) {
+  for (uint32_t offset = 0; offset < size; offset += MEM_PAGE_SIZE) {
+    memcpy(&ram_ref(offset), src + offset, MEM_PAGE_SIZE);
+  }
+}
+
+// roms loaded from memory have no file to keep a save next to
+bool Memory::has_save_file() const {
+  return !file_name.empty() &&
+         (banking_type == MBC1_RAM_BATTERY || banking_type == MBC3_RAM_BATTERY);
+}
+
 int Memory::save_ram() {
-  if (banking_type != MBC1_RAM_BATTERY && banking_type != MBC3_RAM_BATTERY) {
+  if (!has_save_file()) {
     return 0;
   }
+  int64_t start = monotonic_ns();
   std::string save_file = file_name + ".sav";
   int save_fd = open(save_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
   if (save_fd < 0) {
     std::cout << "Error: could not open save file for writing." << std::endl;
     return -1;
   }
-  int bytes_written = write(save_fd, ram_banks, ram_size);
+  uint8_t ram_banks[RAM_BANKS_SIZE];
+  copy_from_ram(ram_banks, save_size());
+  int bytes_written = write(save_fd, ram_banks, save_size());
   close(save_fd);
-  if ((uint32_t)bytes_written != ram_size) {
+  if ((uint32_t)bytes_written != save_size()) {
     std::cout << "An error occurred. The game could not be saved." << std::endl;
     return -1;
   }
+  metrics.save(monotonic_ns() - start);
   return 0;
 }
 
@@ -251,9 +382,9 @@ uint8_t Memory::mbc1_read(uint16_t address) const {
     if (ram_enabled) {
       if (mode_flag) {
         uint32_t offset = 0x2000 * curr_ram_bank;
-        return ram_banks[(address - 0xA000) + offset]; 
+        return ram_read((address - 0xA000) + offset);
       }
-      return ram_banks[address - 0xA000];
+      return ram_read(address - 0xA000);
     }
     else return 0xFF;
   }
@@ -291,9 +422,9 @@ void Memory::mbc1_write(unsigned short address, unsigned char data) {
     // printf("attempted ram write\n");
     if (ram_enabled) {
       if (mode_flag) {
-        ram_banks[(address - 0xA000) + (0x2000 * curr_ram_bank)] = data;
+        ram_ref((address - 0xA000) + (0x2000 * curr_ram_bank)) = data;
       }
-      else ram_banks[address - 0xA000] = data;
+      else ram_ref(address - 0xA000) = data;
     }
   }
 }
@@ -312,7 +443,7 @@ uint8_t Memory::mbc3_read(uint16_t address) const{
   else if (address >= 0xA000 && address <= 0xBFFF) {
     // printf("attempted ram read\n");
     if (ram_enabled) {
-      return ram_banks[(0x2000 * curr_ram_bank) + (address - 0xA000)];
+      return ram_read((0x2000 * curr_ram_bank) + (address - 0xA000));
     }
     else return 0xFF;
   }
@@ -336,7 +467,7 @@ void Memory::mbc3_write(uint16_t address, uint8_t data) {
   else {
     // printf("attempted ram write\n");
     if (ram_enabled) {
-      ram_banks[(address - 0xA000) + (0x2000 * curr_ram_bank)] = data;
+      ram_ref((address - 0xA000) + (0x2000 * curr_ram_bank)) = data;
     }
   }
 }
@@ -355,6 +486,8 @@ uint8_t Memory::mbc_read(unsigned short address) const{
 }
 
 void Memory::mbc_write(unsigned short address, unsigned char data) {
+  uint8_t prev_rom_bank = curr_rom_bank;
+  uint8_t prev_ram_bank = curr_ram_bank;
   if (banking_type == MBC1 || banking_type == MBC1_RAM
       || banking_type == MBC1_RAM_BATTERY) {
     mbc1_write(address, data);
@@ -363,9 +496,27 @@ void Memory::mbc_write(unsigned short address, unsigned char data) {
           || banking_type == MBC3_RAM_BATTERY) {
     mbc3_write(address, data);
   }
+#ifdef GB_MEMORY_STATS
+  if (memory_stats != NULL && curr_rom_bank != prev_rom_bank) {
+    memory_stats->bank_switch(curr_rom_bank);
+  }
+#endif
+  if (trace != NULL) {
+    if (curr_rom_bank != prev_rom_bank) {
+      trace->record(TRACE_ROM_BANK, curr_rom_bank);
+    }
+    if (curr_ram_bank != prev_ram_bank) {
+      trace->record(TRACE_RAM_BANK, curr_ram_bank);
+    }
+  }
 }
 
 void Memory::write_byte(unsigned short address, unsigned char data) {
+#ifdef GB_MEMORY_STATS
+  if (memory_stats != NULL && memory_stats->cpu_access) {
+    memory_stats->count(ACCESS_WRITE, address, 0);
+  }
+#endif
   // 0x0000-0x7FFF is read only
   if (address < 0x8000 || (address >= 0xA000 && address < 0xC000)) {
     mbc_write(address, data);
@@ -374,26 +525,19 @@ void Memory::write_byte(unsigned short address, unsigned char data) {
   // VRAM
   else if (address >= 0x8000 && address <= 0x9FFF) {
     if (get_ppu_mode() != 3) {
-      mem[address] = data;
+      mem_ref(address) = data;
     }
   }
 
-  // writing to internal ram also writes to echo ram
-  else if (address >= 0xC000 && address <=0xDDFF) {
-    mem[address] = data;
-    mem[address + 0x2000] = data;
-  }
-
-  // writing to echo ram also writes to ram
-  else if (address >= 0xE000 && address <= 0xFDFF) {
-    mem[address] = data;
-    mem[address - 0x2000] = data;
+  // internal ram and echo ram share their pages, so one write updates both
+  else if (address >= 0xC000 && address <= 0xFDFF) {
+    mem_ref(address) = data;
   }
 
   // OAM
   else if (address >= 0xFE00 && address <= 0xFE9F) {
     if (get_ppu_mode() < 2) {
-      mem[address] = data;
+      mem_ref(address) = data;
     }
   }
   
@@ -411,15 +555,30 @@ void Memory::write_byte(unsigned short address, unsigned char data) {
   }
 
   else if (address == LY) {
-    mem[LY] = 0;
+    mem_ref(LY) = 0;
     check_lyc_ly();
   }
 
   else if (address == LYC) {
-    mem[LYC] = data;
+    mem_ref(LYC) = data;
     check_lyc_ly();
   }
 
+  else if (address == SC_REG) {
+    // nothing is plugged into the link port, so a transfer on the internal
+    // clock completes at once, shifting in 0xFF. test roms report through it
+    if ((data & 0x81) == 0x81) {
+      if (serial_output != NULL) {
+        serial_output->push_back(mem_read(SB_REG));
+      }
+      mem_ref(SB_REG) = 0xFF;
+      mem_ref(SC_REG) = data & 0x7F;
+      request_interrupt(SERIAL_INTER);
+    } else {
+      mem_ref(SC_REG) = data;
+    }
+  }
+
   else if (address == 0xFF46) { // DMA transfer
     // DMA transfer
     dma_transfer(data);
@@ -427,12 +586,15 @@ void Memory::write_byte(unsigned short address, unsigned char data) {
 
   else if (address == LCD_STATUS) {
     // printf("set LCD STATUS to %d\n", data);
-    mem[address] = (mem[address] & 0b10000111) | (data & 0b01111000);
+    mem_ref(address) = (mem_read(address) & 0b10000111) | (data & 0b01111000);
   }
 
   else if(address == LCD_CONTROL) {
     bool prev_enabled = is_lcd_enabled();
-    mem[address] = data;
+    mem_ref(address) = data;
+    if (trace != NULL && is_lcd_enabled() != prev_enabled) {
+      trace->record(prev_enabled ? TRACE_LCD_OFF : TRACE_LCD_ON);
+    }
     if (is_lcd_enabled() && !prev_enabled) {
       // if (cpu->state != BOOTING) printf("lcd enabled\n");
       check_lyc_ly();
@@ -443,12 +605,17 @@ void Memory::write_byte(unsigned short address, unsigned char data) {
   }
 
   else {
-    mem[address] = data;
+    mem_ref(address) = data;
   }
 }
 
 
 unsigned char Memory::read_byte(unsigned short address) const {
+#ifdef GB_MEMORY_STATS
+  if (memory_stats != NULL && memory_stats->cpu_access) {
+    memory_stats->count(ACCESS_READ, address, rom_bank_at(address));
+  }
+#endif
   if (address < 0x100 && cpu->state == BOOTING) {
     return boot_rom[address];
   }
@@ -473,7 +640,7 @@ unsigned char Memory::read_byte(unsigned short address) const {
     if (get_ppu_mode() == 3) {
       return 0xFF;
     }
-    return mem[address];
+    return mem_read(address);
   }
 
   // reading from RAM bank
@@ -481,7 +648,7 @@ unsigned char Memory::read_byte(unsigned short address) const {
     if (banking_type != NO_BANKING) {
       return mbc_read(address);
     }
-    return ram_banks[(address - 0xA000) + (curr_ram_bank * 0x2000)];
+    return ram_read((address - 0xA000) + (curr_ram_bank * 0x2000));
   }
   
   // OAM
@@ -489,7 +656,7 @@ unsigned char Memory::read_byte(unsigned short address) const {
     if (get_ppu_mode() >= 2) {
       return 0xFF;
     }
-    return mem[address];
+    return mem_read(address);
   }
 
   else if (address >= DIV_REG && address <= TAC_REG) {
@@ -503,17 +670,98 @@ unsigned char Memory::read_byte(unsigned short address) const {
   }
 
   else if (address == IF_REG) {
-    return mem[address] | 0xE0;
+    return mem_read(address) | 0xE0;
   }
 
   else if (address == LCD_STATUS) {
-    return mem[LCD_STATUS] | 0b10000000;
+    return mem_read(LCD_STATUS) | 0b10000000;
     // printf("STAT: %d\n", mem[LCD_STATUS]);
   }
 
-  return mem[address];
+  return mem_read(address);
+}
+
+
+// identifies the cartridge a savestate belongs to
+uint32_t Memory::rom_checksum() const {
+  return (cart[0x14D] << 16) | (cart[0x14E] << 8) | cart[0x14F];
+}
+
+// hash of the whole rom image, for telling carts with equal headers apart
+uint64_t Memory::rom_hash() const {
+  return fnv1a(cart.get(), rom_size());
+}
+
+uint32_t Memory::rom_size() const { return num_rom_banks * 0x4000; }
+
+// drops the battery save loaded at startup (for runs that must be reproducible)
+void Memory::clear_ram() {
+  for (std::shared_ptr<page_t> &page : ram_pages) {
+    page = zero_page;
+  }
+}
+
+// the rom area and the unused 0xA000-0xBFFF copy in mem are never written and
+// echo ram shares the wram pages, so only vram, wram, oam through hram and the
+// populated ram banks are stored
+void Memory::save_state(StateWriter &state) const {
+  for (int page = VRAM_START >> 8; page <= VRAM_END >> 8; page++) {
+    state.write(mem_data[page], MEM_PAGE_SIZE);
+  }
+  for (int page = RAM_START >> 8; page <= RAM_END >> 8; page++) {
+    state.write(mem_data[page], MEM_PAGE_SIZE);
+  }
+  for (int page = OAM_START >> 8; page <= 0xFF; page++) {
+    state.write(mem_data[page], MEM_PAGE_SIZE);
+  }
+  for (uint32_t offset = 0; offset < save_size(); offset += MEM_PAGE_SIZE) {
+    state.write(ram_pages[offset >> 8]->data(), MEM_PAGE_SIZE);
+  }
+  state.value<uint8_t>(curr_rom_bank);
+  state.value<uint8_t>(curr_ram_bank);
+  state.value<uint8_t>(mode_flag);
+  state.value<uint8_t>(ram_enabled);
+}
+
+void Memory::load_state(StateReader &state) {
+  for (int page = VRAM_START >> 8; page <= VRAM_END >> 8; page++) {
+    state.read(&mem_ref(page << 8), MEM_PAGE_SIZE);
+  }
+  for (int page = RAM_START >> 8; page <= RAM_END >> 8; page++) {
+    state.read(&mem_ref(page << 8), MEM_PAGE_SIZE);
+  }
+  for (int page = OAM_START >> 8; page <= 0xFF; page++) {
+    state.read(&mem_ref(page << 8), MEM_PAGE_SIZE);
+  }
+  for (uint32_t offset = 0; offset < save_size(); offset += MEM_PAGE_SIZE) {
+    state.read(&ram_ref(offset), MEM_PAGE_SIZE);
+  }
+  curr_rom_bank = state.value<uint8_t>();
+  curr_ram_bank = state.value<uint8_t>();
+  mode_flag = state.value<uint8_t>();
+  ram_enabled = state.value<uint8_t>();
 }
 
+// reads without the ppu access restrictions or side effects of read_byte
+// (used by code observing the machine from the outside)
+uint8_t Memory::peek_byte(uint16_t address) const {
+  if ((address >= VRAM_START && address <= VRAM_END) ||
+      (address >= OAM_START && address <= OAM_END)) {
+    return mem_read(address);
+  }
+  else if (address >= EXT_RAM_START && address <= EXT_RAM_END) {
+    uint8_t bank = curr_ram_bank;
+    if ((banking_type == MBC1 || banking_type == MBC1_RAM
+         || banking_type == MBC1_RAM_BATTERY) && !mode_flag) {
+      bank = 0;
+    }
+    return ram_read((address - EXT_RAM_START) + (0x2000 * bank));
+  }
+  else if (address == JOYPAD_REG) {
+    return joypad->peek_joypad_state();
+  }
+  return read_byte(address);
+}
 
 // gameboy is little endian
 unsigned short Memory::read_word(unsigned short address) const {
@@ -529,58 +777,72 @@ void Memory::request_interrupt(uint8_t bit) {
   if (!cpu->ime && bit == STAT_INTER) {
     return;
   }
+  if (trace != NULL) {
+    trace->record(TRACE_INTERRUPT_REQUEST, bit);
+  }
   write_byte(IF_REG, read_byte(IF_REG) | (1 << bit));
 }
 
 void Memory::reset_scanline() {
-  mem[LY] = 0;
+  mem_ref(LY) = 0;
   check_lyc_ly();
 }
 
-// void Memory::set_scanline(uint8_t ly) {
-//   mem[LY] = ly;
-// }
+uint8_t Memory::rom_bank_at(uint16_t address) const {
+  return address >= ROM_1_START && address <= ROM_1_END ? curr_rom_bank : 0;
+}
+
+void Memory::set_scanline(uint8_t ly) {
+  mem_ref(LY) = ly;
+  check_lyc_ly();
+}
 
 void Memory::inc_scanline() {
-  mem[LY]++; 
+  mem_ref(LY)++;
   check_lyc_ly();
 }
 
 void Memory::check_lyc_ly() {
   if (is_lcd_enabled()) {
-    if (mem[LY] == mem[LYC]) {
-      if (((mem[LCD_STATUS] >> 2) & 1) == 1) {
+    if (mem_read(LY) == mem_read(LYC)) {
+      if (((mem_read(LCD_STATUS) >> 2) & 1) == 1) {
         return;
       }
-      mem[LCD_STATUS] = mem[LCD_STATUS] | (1 << 2);
-      if ((mem[LCD_STATUS] >> 6) & 0x1) {
+      mem_ref(LCD_STATUS) = mem_read(LCD_STATUS) | (1 << 2);
+      if ((mem_read(LCD_STATUS) >> 6) & 0x1) {
         request_interrupt(STAT_INTER);
       }
     }
     else {
-      mem[LCD_STATUS] = mem[LCD_STATUS] & ~(1 << 2);
+      mem_ref(LCD_STATUS) = mem_read(LCD_STATUS) & ~(1 << 2);
     }
   }
 }
 
 void Memory::dma_transfer(uint8_t data) {
   // printf("dma transfer %02X %d %d\n", data, mem[LY], mem[LCD_STATUS] & 0x3);
+  if (trace != NULL) {
+    trace->record(TRACE_DMA, data);
+  }
   uint16_t xfer_i = data << 8;
   for (int i = 0xFE00; i < 0xFEA0; i++) {
     // mem[i] = mem[xfer_i];
-    mem[i] = read_byte(xfer_i);
+    mem_ref(i) = read_byte(xfer_i);
     xfer_i++;
   }
 }
 
 bool Memory::is_lcd_enabled() const {
-  return (mem[LCD_CONTROL] >> 7) & 1;
+  return (mem_read(LCD_CONTROL) >> 7) & 1;
 }
 
 uint8_t Memory::get_ppu_mode() const {
-  return mem[LCD_STATUS] & 0x3;
+  return mem_read(LCD_STATUS) & 0x3;
 }
 
 void Memory::set_ppu_mode(uint8_t mode) {
-  mem[LCD_STATUS] = (mem[LCD_STATUS] & 0b11111100) | (mode & 0b00000011);
+  if (trace != NULL && (mem_read(LCD_STATUS) & 3) != (mode & 3)) {
+    trace->record(TRACE_PPU_MODE, mode & 3);
+  }
+  mem_ref(LCD_STATUS) = (mem_read(LCD_STATUS) & 0b11111100) | (mode & 0b00000011);
 }
@@ -0,0 +1,133 @@
+#include "memory_stats.hh"
+#include "constants.hh"
+#include "savestate.hh"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+struct Region {
+  const char *name;
+  uint32_t start;
+  uint32_t end; // exclusive
+};
+
+static const Region regions[] = {
+    {"ROM0", 0x0000, 0x4000}, {"ROMX", 0x4000, 0x8000},
+    {"VRAM", 0x8000, 0xA000}, {"SRAM", 0xA000, 0xC000},
+    {"WRAM", 0xC000, 0xE000}, {"ECHO", 0xE000, 0xFE00},
+    {"OAM", 0xFE00, 0xFF00},  {"IO", 0xFF00, 0xFF80},
+    {"HRAM", 0xFF80, 0x10000},
+};
+
+MemoryStats::MemoryStats(const std::string &file_name) {
+  file = fopen(file_name.c_str(), "wb");
+  if (file == NULL) {
+    std::cerr << "Could not create " << file_name << std::endl;
+    exit(1);
+  }
+  memset(lines, 0, sizeof(lines));
+  memset(bank_switches, 0, sizeof(bank_switches));
+  memset(bank_cycles, 0, sizeof(bank_cycles));
+  memset(bank_reads, 0, sizeof(bank_reads));
+  cpu_access = false;
+}
+
+MemoryStats::~MemoryStats() {
+  std::vector<uint8_t> out;
+  StateWriter writer(out);
+  writer.value<uint32_t>(MEMORY_STATS_MAGIC);
+  writer.value<uint32_t>(MEMORY_STATS_VERSION);
+  writer.value<uint32_t>(MEMORY_STATS_LINE);
+  writer.value<uint32_t>(MEMORY_STATS_LINES);
+  for (int access = 0; access < NUM_ACCESSES; access++) {
+    for (int line = 0; line < MEMORY_STATS_LINES; line++) {
+      writer.value<uint64_t>(lines[access][line]);
+    }
+  }
+  for (int bank = 0; bank < MEMORY_STATS_BANKS; bank++) {
+    writer.value<uint64_t>(bank_switches[bank]);
+    writer.value<uint64_t>(bank_cycles[bank]);
+    writer.value<uint64_t>(bank_reads[bank]);
+  }
+  if (fwrite(out.data(), 1, out.size(), file) != out.size()) {
+    std::cerr << "Could not write memory stats" << std::endl;
+  }
+  fclose(file);
+  print();
+}
+
+void MemoryStats::print() const {
+  uint64_t total_cycles = 0, total_switches = 0;
+  for (int bank = 0; bank < MEMORY_STATS_BANKS; bank++) {
+    total_cycles += bank_cycles[bank];
+    total_switches += bank_switches[bank];
+  }
+  if (total_cycles == 0) {
+    return;
+  }
+
+  fprintf(stderr, "Memory accesses by region:\n  %-5s %14s %14s %14s\n",
+          "", "reads", "writes", "fetches");
+  for (const Region &region : regions) {
+    uint64_t sums[NUM_ACCESSES] = {0};
+    for (uint32_t line = region.start / MEMORY_STATS_LINE;
+         line < region.end / MEMORY_STATS_LINE; line++) {
+      for (int access = 0; access < NUM_ACCESSES; access++) {
+        sums[access] += lines[access][line];
+      }
+    }
+    fprintf(stderr, "  %-5s %14llu %14llu %14llu\n", region.name,
+            (unsigned long long)sums[ACCESS_READ],
+            (unsigned long long)sums[ACCESS_WRITE],
+            (unsigned long long)sums[ACCESS_FETCH]);
+  }
+
+  std::vector<int> hot(MEMORY_STATS_LINES);
+  for (int line = 0; line < MEMORY_STATS_LINES; line++) {
+    hot[line] = line;
+  }
+  auto total = [this](int line) {
+    return lines[ACCESS_READ][line] + lines[ACCESS_WRITE][line] +
+           lines[ACCESS_FETCH][line];
+  };
+  std::stable_sort(hot.begin(), hot.end(),
+                   [&](int a, int b) { return total(a) > total(b); });
+  fprintf(stderr, "\nHottest lines:\n  %-9s %14s %14s %14s\n", "address",
+          "reads", "writes", "fetches");
+  for (int i = 0; i < MEMORY_REPORT_ROWS && total(hot[i]) > 0; i++) {
+    int line = hot[i];
+    fprintf(stderr, "  %04X-%04X %14llu %14llu %14llu\n",
+            line * MEMORY_STATS_LINE, line * MEMORY_STATS_LINE +
+                                          MEMORY_STATS_LINE - 1,
+            (unsigned long long)lines[ACCESS_READ][line],
+            (unsigned long long)lines[ACCESS_WRITE][line],
+            (unsigned long long)lines[ACCESS_FETCH][line]);
+  }
+
+  // banks that were never mapped at 0x4000 are left out. carts without
+  // banking report bank 1 there, the second half of the rom
+  std::vector<int> banks;
+  for (int bank = 0; bank < MEMORY_STATS_BANKS; bank++) {
+    if (bank_cycles[bank] > 0 || bank_switches[bank] > 0) {
+      banks.push_back(bank);
+    }
+  }
+  std::stable_sort(banks.begin(), banks.end(), [this](int a, int b) {
+    return bank_cycles[a] > bank_cycles[b];
+  });
+  double seconds = (double)total_cycles / CYCLES_PER_SECOND;
+  fprintf(stderr,
+          "\n%llu rom bank switches in %.1f emulated seconds (%.1f per "
+          "frame)\n  %-4s %12s %7s %14s\n",
+          (unsigned long long)total_switches, seconds,
+          total_switches / (seconds * (1000.0 / FRAME_PERIOD)), "bank", "switches", "time",
+          "reads");
+  for (size_t i = 0; i < banks.size() && i < MEMORY_REPORT_ROWS; i++) {
+    int bank = banks[i];
+    fprintf(stderr, "  %-4d %12llu %6.2f%% %14llu\n", bank,
+            (unsigned long long)bank_switches[bank],
+            100.0 * bank_cycles[bank] / total_cycles,
+            (unsigned long long)bank_reads[bank]);
+  }
+}
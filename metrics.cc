@@ -0,0 +1,181 @@
+#include "metrics.hh"
+#include "constants.hh"
+#include "pacer.hh"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+Metrics metrics;
+
+// fine around the 16.74 ms of a normal speed frame
+const int64_t metrics_bucket_us[METRICS_BUCKETS - 1] = {
+    2000, 4000, 8000, 12000, 16000, 17000, 18000, 20000, 25000, 33000, 50000};
+
+MetricsPublisher::MetricsPublisher(const std::string &file_name)
+    : file_name(file_name), temp_name(file_name + ".tmp") {
+  last_time = monotonic_ns();
+  last_frames = metrics.frames.load(std::memory_order_relaxed);
+  for (int i = 0; i < METRICS_BUCKETS; i++) {
+    last_buckets[i] = metrics.frame_buckets[i].load(std::memory_order_relaxed);
+  }
+  FILE *file = fopen(temp_name.c_str(), "w");
+  if (file == NULL) {
+    std::cerr << "Could not create " << temp_name << std::endl;
+    exit(1);
+  }
+  fclose(file);
+
+  shutdown = false;
+  worker = std::thread(&MetricsPublisher::worker_loop, this);
+}
+
+MetricsPublisher::~MetricsPublisher() {
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    shutdown = true;
+  }
+  wake.notify_one();
+  worker.join();
+  publish();
+}
+
+void MetricsPublisher::worker_loop() {
+  std::unique_lock<std::mutex> guard(lock);
+  while (!shutdown) {
+    wake.wait_for(guard, std::chrono::milliseconds(METRICS_INTERVAL_MS));
+    if (!shutdown) {
+      publish();
+    }
+  }
+}
+
+void MetricsPublisher::publish() {
+  int64_t now = monotonic_ns();
+  double seconds = (now - last_time) / 1e9;
+  uint64_t frames = metrics.frames.load(std::memory_order_relaxed);
+  uint64_t buckets[METRICS_BUCKETS];
+  uint64_t window[METRICS_BUCKETS];
+  uint64_t window_frames = 0;
+  for (int i = 0; i < METRICS_BUCKETS; i++) {
+    buckets[i] = metrics.frame_buckets[i].load(std::memory_order_relaxed);
+    window[i] = buckets[i] - last_buckets[i];
+    window_frames += window[i];
+    last_buckets[i] = buckets[i];
+  }
+  double fps = seconds > 0 ? (frames - last_frames) / seconds : 0;
+  last_time = now;
+  last_frames = frames;
+
+  FILE *file = fopen(temp_name.c_str(), "w");
+  if (file == NULL) {
+    std::cerr << "Could not write " << temp_name << std::endl;
+    return;
+  }
+  fprintf(file,
+          "# HELP gb_instances Emulated machines alive, incl. run-ahead "
+          "copies.\n# TYPE gb_instances gauge\ngb_instances %lld\n",
+          (long long)metrics.instances.load(std::memory_order_relaxed));
+  fprintf(file, "# HELP gb_frames_total Frames emulated.\n"
+                "# TYPE gb_frames_total counter\ngb_frames_total %llu\n",
+          (unsigned long long)frames);
+  fprintf(file, "# HELP gb_fps Frames emulated per second.\n"
+                "# TYPE gb_fps gauge\ngb_fps %.3f\n",
+          fps);
+  fprintf(file,
+          "# HELP gb_realtime_factor Emulated time per wall time, 1 is "
+          "real hardware speed.\n# TYPE gb_realtime_factor gauge\n"
+          "gb_realtime_factor %.4f\n",
+          fps * FRAME_PERIOD / 1000.0);
+
+  // cumulative, as prometheus histograms are
+  fprintf(file, "# HELP gb_frame_seconds Wall time per frame, incl. pacing.\n"
+                "# TYPE gb_frame_seconds histogram\n");
+  uint64_t count = 0;
+  for (int i = 0; i < METRICS_BUCKETS; i++) {
+    count += buckets[i];
+    if (i < METRICS_BUCKETS - 1) {
+      fprintf(file, "gb_frame_seconds_bucket{le=\"%g\"} %llu\n",
+              metrics_bucket_us[i] / 1e6, (unsigned long long)count);
+    } else {
+      fprintf(file, "gb_frame_seconds_bucket{le=\"+Inf\"} %llu\n",
+              (unsigned long long)count);
+    }
+  }
+  fprintf(file, "gb_frame_seconds_sum %.6f\ngb_frame_seconds_count %llu\n",
+          metrics.frame_ns.load(std::memory_order_relaxed) / 1e9,
+          (unsigned long long)count);
+
+  // interpolated within the bucket like histogram_quantile, so a scraper
+  // without a query engine still gets percentiles
+  if (window_frames > 0) {
+    fprintf(file, "# HELP gb_frame_quantile_seconds Frame time percentiles "
+                  "over the last interval.\n"
+                  "# TYPE gb_frame_quantile_seconds gauge\n");
+    const double quantiles[3] = {0.5, 0.9, 0.99};
+    for (double q : quantiles) {
+      double rank = q * window_frames;
+      uint64_t below = 0;
+      int i = 0;
+      while (i < METRICS_BUCKETS - 1 && below + window[i] < rank) {
+        below += window[i];
+        i++;
+      }
+      double value;
+      if (i == METRICS_BUCKETS - 1) {
+        value = metrics_bucket_us[i - 1] / 1e6;
+      } else {
+        double lower = i > 0 ? metrics_bucket_us[i - 1] : 0;
+        value = (lower + (metrics_bucket_us[i] - lower) * (rank - below) /
+                             window[i]) /
+                1e6;
+      }
+      fprintf(file, "gb_frame_quantile_seconds{quantile=\"%g\"} %.6f\n", q,
+              value);
+    }
+  }
+
+  fprintf(file,
+          "# HELP gb_frames_over_budget_total Frames that took longer to "
+          "emulate than their period.\n"
+          "# TYPE gb_frames_over_budget_total counter\n"
+          "gb_frames_over_budget_total %llu\n",
+          (unsigned long long)metrics.frames_over_budget.load(
+              std::memory_order_relaxed));
+  fprintf(file,
+          "# HELP gb_pacing_overshoot_seconds How late frame pacing woke "
+          "after a deadline it waited for.\n# TYPE gb_pacing_overshoot_seconds summary\n"
+          "gb_pacing_overshoot_seconds_sum %.6f\n"
+          "gb_pacing_overshoot_seconds_count %llu\n",
+          metrics.overshoot_ns.load(std::memory_order_relaxed) / 1e9,
+          (unsigned long long)metrics.overshoots.load(
+              std::memory_order_relaxed));
+  fprintf(file,
+          "# HELP gb_pacing_overshoot_max_seconds Worst overshoot over the "
+          "last interval.\n# TYPE gb_pacing_overshoot_max_seconds gauge\n"
+          "gb_pacing_overshoot_max_seconds %.6f\n",
+          metrics.overshoot_max_ns.exchange(0, std::memory_order_relaxed) /
+              1e9);
+  fprintf(file,
+          "# HELP gb_pacing_late_seconds How far behind schedule frames "
+          "reached the pacer.\n# TYPE gb_pacing_late_seconds summary\n"
+          "gb_pacing_late_seconds_sum %.6f\n"
+          "gb_pacing_late_seconds_count %llu\n",
+          metrics.late_ns.load(std::memory_order_relaxed) / 1e9,
+          (unsigned long long)metrics.late_frames.load(
+              std::memory_order_relaxed));
+  fprintf(file,
+          "# HELP gb_save_flush_seconds Time to write the battery save.\n"
+          "# TYPE gb_save_flush_seconds summary\n"
+          "gb_save_flush_seconds_sum %.6f\ngb_save_flush_seconds_count %llu\n",
+          metrics.save_ns.load(std::memory_order_relaxed) / 1e9,
+          (unsigned long long)metrics.saves.load(std::memory_order_relaxed));
+  fprintf(file,
+          "# HELP gb_save_flush_last_seconds Time the latest battery save "
+          "took.\n# TYPE gb_save_flush_last_seconds gauge\n"
+          "gb_save_flush_last_seconds %.6f\n",
+          metrics.save_last_ns.load(std::memory_order_relaxed) / 1e9);
+
+  if (fclose(file) != 0 || rename(temp_name.c_str(), file_name.c_str()) != 0) {
+    std::cerr << "Could not write " << file_name << std::endl;
+  }
+}
@@ -0,0 +1,335 @@
+#include "constants.hh"
+#include "cpu.hh"
+#include "gpu.hh"
+#include "joypad.hh"
+#include "memory.hh"
+#include "pacer.hh"
+#include "profiler.hh"
+#include "timer.hh"
+#include <algorithm>
+#include <cmath>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+// microbenchmarks of the core's hot paths, each on a synthetic rom built in
+// memory and without a window. every benchmark runs a few untimed batches
+// to warm up, then times repeated batches and reports the median cost per
+// operation with the spread between batches
+
+#define WARMUP_BATCHES (3)
+#define ROM_SIZE (0x8000)
+
+static int repeats = 21;
+static const char *filter = NULL;
+static volatile uint8_t sink;
+
+// a 32KiB rom without banking with code at 0x0000 and a valid header, so it
+// can run with the boot rom skipped
+static std::vector<uint8_t> make_rom(const std::vector<uint8_t> &code) {
+  std::vector<uint8_t> rom(ROM_SIZE, 0);
+  std::copy(code.begin(), code.end(), rom.begin());
+  const char *title = "MICROBENCH";
+  memcpy(&rom[0x134], title, strlen(title));
+  uint8_t checksum = 0;
+  for (uint16_t address = 0x0134; address <= 0x014C; address++) {
+    checksum = checksum - rom[address] - 1;
+  }
+  rom[0x14D] = checksum;
+  return rom;
+}
+
+// code that repeats body to fill most of the space before the header, then
+// jumps back to the start
+static std::vector<uint8_t> loop_code(const std::vector<uint8_t> &prologue,
+                                      const std::vector<uint8_t> &body) {
+  std::vector<uint8_t> code = prologue;
+  while (code.size() + body.size() + 3 <= 0x100) {
+    code.insert(code.end(), body.begin(), body.end());
+  }
+  code.insert(code.end(), {0xC3, 0x00, 0x00}); // JP 0x0000
+  return code;
+}
+
+struct Machine {
+  Memory mmu;
+  Cpu cpu;
+  Gpu gpu;
+  Timer timer;
+  Joypad joypad;
+
+  Machine(const std::vector<uint8_t> &rom)
+      : mmu(rom.data(), rom.size()), cpu(mmu), gpu(mmu), timer(mmu),
+        joypad(mmu) {
+    mmu.set_timer(&timer);
+    mmu.set_joypad(&joypad);
+    mmu.set_cpu(&cpu);
+    cpu.state = RUNNING; // straight to the rom, pc starts at 0x0000
+    mmu.set_ppu_mode(0); // vram and oam accessible
+  }
+};
+
+static bool selected(const char *name) {
+  return filter == NULL || strstr(name, filter) != NULL;
+}
+
+static double median(std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  return values[values.size() / 2];
+}
+
+static void report(const char *name, const std::vector<double> &tick_costs,
+                   const std::vector<double> &ns_costs) {
+  double mid = median(tick_costs);
+  std::vector<double> deviations;
+  for (double cost : tick_costs) {
+    deviations.push_back(std::fabs(cost - mid));
+  }
+  printf("%-28s %10.2f %s/op  (min %.2f, mad %4.1f%%)  %8.2f ns/op\n", name,
+         mid, TICK_UNIT,
+         *std::min_element(tick_costs.begin(), tick_costs.end()),
+         mid > 0 ? 100 * median(deviations) / mid : 0.0, median(ns_costs));
+}
+
+// batch runs one batch of operations and returns how many it did
+template <typename F> static void bench(const char *name, F batch) {
+  if (!selected(name)) {
+    return;
+  }
+  for (int i = 0; i < WARMUP_BATCHES; i++) {
+    batch();
+  }
+  std::vector<double> tick_costs, ns_costs;
+  for (int i = 0; i < repeats; i++) {
+    int64_t start_ns = monotonic_ns();
+    uint64_t start = read_ticks();
+    uint64_t ops = batch();
+    uint64_t elapsed = read_ticks() - start;
+    int64_t elapsed_ns = monotonic_ns() - start_ns;
+    tick_costs.push_back((double)elapsed / ops);
+    ns_costs.push_back((double)elapsed_ns / ops);
+  }
+  report(name, tick_costs, ns_costs);
+}
+
+static void bench_read_byte() {
+  struct Region {
+    const char *name;
+    uint16_t start;
+    uint16_t length;
+  };
+  const Region regions[] = {
+      {"read_byte rom0", 0x0150, 0x100}, {"read_byte romx", 0x4000, 0x100},
+      {"read_byte vram", 0x8000, 0x100}, {"read_byte wram", 0xC000, 0x100},
+      {"read_byte echo", 0xE000, 0x100}, {"read_byte oam", 0xFE00, 0xA0},
+      {"read_byte io", 0xFF00, 0x80},    {"read_byte hram", 0xFF80, 0x7F},
+  };
+  Machine machine(make_rom({}));
+  for (const Region &region : regions) {
+    bench(region.name, [&] {
+      uint8_t sum = 0;
+      for (int pass = 0; pass < 64; pass++) {
+        for (uint16_t i = 0; i < region.length; i++) {
+          sum += machine.mmu.read_byte(region.start + i);
+        }
+      }
+      sink = sum;
+      return (uint64_t)64 * region.length;
+    });
+  }
+}
+
+static void bench_write_byte() {
+  struct Register {
+    const char *name;
+    uint16_t address;
+  };
+  // each io register with its own write path
+  const Register registers[] = {
+      {"write_byte io bgp", 0xFF47},  {"write_byte io tima", TIMA_REG},
+      {"write_byte io stat", LCD_STATUS}, {"write_byte io lyc", LYC},
+      {"write_byte io lcdc", LCD_CONTROL}, {"write_byte io joyp", 0xFF00},
+      {"write_byte io dma", 0xFF46},
+  };
+  Machine machine(make_rom({}));
+  for (const Register &reg : registers) {
+    bench(reg.name, [&] {
+      for (int i = 0; i < 4096; i++) {
+        // dma copies from the rom, lcdc keeps the lcd off
+        machine.mmu.write_byte(reg.address, 0x40 | (i & 0x30));
+      }
+      return (uint64_t)4096;
+    });
+  }
+}
+
+static void bench_fetch_and_execute() {
+  struct Mix {
+    const char *name;
+    std::vector<uint8_t> code;
+  };
+  const Mix mixes[] = {
+      // ADD A,B; XOR C; INC D; DEC E; OR H
+      {"execute alu", loop_code({}, {0x80, 0xA9, 0x14, 0x1D, 0xB4})},
+      // LD HL,C000 then LD (HL+),A; LD A,(HL); DEC HL; LD (HL),A
+      {"execute load/store",
+       loop_code({0x21, 0x00, 0xC0}, {0x22, 0x7E, 0x2B, 0x77})},
+      // LD B,16; loop: DEC B; JR NZ,loop; CALL sub; JP 0; sub: RET
+      {"execute branch",
+       {0x06, 0x10, 0x05, 0x20, 0xFD, 0xCD, 0x0B, 0x00, 0xC3, 0x00, 0x00,
+        0xC9}},
+      // SWAP A; BIT 0,B; RL C
+      {"execute cb prefix", loop_code({}, {0xCB, 0x37, 0xCB, 0x40, 0xCB, 0x11})},
+  };
+  for (const Mix &mix : mixes) {
+    Machine machine(make_rom(mix.code));
+    bench(mix.name, [&] {
+      uint64_t first = machine.cpu.instructions;
+      for (int i = 0; i < 10000; i++) {
+        machine.cpu.fetch_and_execute();
+      }
+      return machine.cpu.instructions - first;
+    });
+  }
+}
+
+static void bench_timer() {
+  Machine machine(make_rom({}));
+  machine.mmu.write_byte(TAC_REG, 0x05); // enabled, fastest rate
+  bench("timer tick", [&] {
+    for (int i = 0; i < 70224; i++) {
+      machine.timer.tick();
+    }
+    return (uint64_t)70224;
+  });
+}
+
+static void bench_draw_line() {
+  const int sprite_counts[] = {0, 5, 10};
+  for (int count : sprite_counts) {
+    Machine machine(make_rom({}));
+    Memory &mmu = machine.mmu;
+    for (uint16_t address = VRAM_START; address < 0x9800; address++) {
+      mmu.write_byte(address, address * 37);
+    }
+    for (uint16_t address = 0x9800; address < 0xA000; address++) {
+      mmu.write_byte(address, address);
+    }
+    // sprites all overlap the drawn line, the rest sit off screen
+    const uint8_t line = 64;
+    for (int i = 0; i < 40; i++) {
+      uint16_t addr = OAM_START + i * 4;
+      mmu.write_byte(addr, i < count ? line + 16 : 0);
+      mmu.write_byte(addr + 1, 8 + i * 16);
+      mmu.write_byte(addr + 2, i);
+      mmu.write_byte(addr + 3, 0);
+    }
+    mmu.write_byte(0xFF47, 0xE4);
+    mmu.write_byte(0xFF48, 0xE4);
+    mmu.write_byte(LCD_CONTROL, 0x93); // lcd, 0x8000 tile data, obj, bg
+    mmu.set_ppu_mode(0);
+    mmu.set_scanline(line);
+
+    char name[64];
+    snprintf(name, sizeof(name), "draw_line %d sprites", count);
+    bench(name, [&] {
+      for (int i = 0; i < 256; i++) {
+        machine.gpu.draw_line();
+      }
+      return (uint64_t)256;
+    });
+  }
+}
+
+// every call is timed on its own and charged to the mode the ppu was in,
+// minus the cost of reading the clock
+static void bench_gpu_step() {
+  const char *names[] = {"gpu step hblank (mode 0)", "gpu step vblank (mode 1)",
+                         "gpu step oam (mode 2)", "gpu step draw (mode 3)"};
+  bool any = false;
+  for (const char *name : names) {
+    any |= selected(name);
+  }
+  if (!any) {
+    return;
+  }
+
+  std::vector<double> overheads;
+  for (int i = 0; i < 1001; i++) {
+    uint64_t start = read_ticks();
+    overheads.push_back(read_ticks() - start);
+  }
+  double overhead = median(overheads);
+
+  Machine machine(make_rom({}));
+  machine.mmu.write_byte(0xFF47, 0xE4);
+  machine.mmu.write_byte(LCD_CONTROL, 0x91);
+  const int CALLS_PER_FRAME = 70224 / 4;
+  for (int i = 0; i < WARMUP_BATCHES * CALLS_PER_FRAME; i++) {
+    machine.gpu.step(4);
+  }
+
+  // one frame per repetition
+  std::vector<double> tick_costs[4], ns_costs[4];
+  for (int r = 0; r < repeats; r++) {
+    double total[4] = {};
+    uint64_t calls[4] = {};
+    for (int i = 0; i < CALLS_PER_FRAME; i++) {
+      uint8_t mode = machine.mmu.get_ppu_mode() & 3;
+      uint64_t start = read_ticks();
+      machine.gpu.step(4);
+      total[mode] += read_ticks() - start - overhead;
+      calls[mode]++;
+    }
+    for (int mode = 0; mode < 4; mode++) {
+      if (calls[mode] > 0) {
+        tick_costs[mode].push_back(total[mode] / calls[mode]);
+      }
+    }
+  }
+  // the counter's rate in ns, measured over one more frame
+  uint64_t start = read_ticks();
+  int64_t start_ns = monotonic_ns();
+  for (int i = 0; i < CALLS_PER_FRAME; i++) {
+    machine.gpu.step(4);
+  }
+  double ns_per_tick =
+      (double)(monotonic_ns() - start_ns) / std::max<uint64_t>(1, read_ticks() - start);
+  for (int mode = 0; mode < 4; mode++) {
+    if (!selected(names[mode]) || tick_costs[mode].empty()) {
+      continue;
+    }
+    for (double cost : tick_costs[mode]) {
+      ns_costs[mode].push_back(cost * ns_per_tick);
+    }
+    report(names[mode], tick_costs[mode], ns_costs[mode]);
+  }
+}
+
+static void usage() {
+  printf("Usage: gbmicro [--repeats n] [name filter]\n");
+  exit(1);
+}
+
+int main(int argc, char *argv[]) {
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--repeats") == 0 && i + 1 < argc) {
+      repeats = atoi(argv[++i]);
+    } else if (filter == NULL && argv[i][0] != '-') {
+      filter = argv[i];
+    } else {
+      usage();
+    }
+  }
+  if (repeats <= 0) {
+    usage();
+  }
+
+  bench_read_byte();
+  bench_write_byte();
+  bench_fetch_and_execute();
+  bench_timer();
+  bench_draw_line();
+  bench_gpu_step();
+  return 0;
+}
@@ -0,0 +1,124 @@
+#include "movie.hh"
+#include "savestate.hh"
+#include <cstdio>
+
+Movie::Movie() {
+  frames = 0;
+  hash_interval = MOVIE_HASH_INTERVAL;
+  run = 0;
+  run_frame = 0;
+  rom_hash = 0;
+}
+
+void Movie::record(uint8_t buttons) {
+  if (!runs.empty() && runs.back().second == buttons) {
+    runs.back().first++;
+  } else {
+    runs.emplace_back(1, buttons);
+  }
+  frames++;
+}
+
+void Movie::record_hash(uint64_t state_hash) { hashes.push_back(state_hash); }
+
+bool Movie::is_hash_frame(uint32_t frame) const {
+  return frame % hash_interval == 0;
+}
+
+uint32_t Movie::length() const { return frames; }
+
+uint8_t Movie::next_buttons() {
+  while (run < runs.size() && run_frame >= runs[run].first) {
+    run++;
+    run_frame = 0;
+  }
+  if (run == runs.size()) {
+    return 0;
+  }
+  run_frame++;
+  return runs[run].second;
+}
+
+bool Movie::hash_at(uint32_t frame, uint64_t &state_hash) const {
+  size_t index = frame / hash_interval;
+  if (!is_hash_frame(frame) || index >= hashes.size()) {
+    return false;
+  }
+  state_hash = hashes[index];
+  return true;
+}
+
+bool Movie::save(const std::string &movie_file) const {
+  std::vector<uint8_t> buffer;
+  StateWriter out(buffer);
+  out.value<uint32_t>(MOVIE_MAGIC);
+  out.value<uint32_t>(MOVIE_VERSION);
+  out.value<uint64_t>(rom_hash);
+  out.value<uint32_t>(frames);
+  out.value<uint32_t>(hash_interval);
+  out.value<uint32_t>(runs.size());
+  out.value<uint32_t>(hashes.size());
+  for (const std::pair<uint32_t, uint8_t> &r : runs) {
+    out.varint(r.first);
+    out.value<uint8_t>(r.second);
+  }
+  for (uint64_t hash : hashes) {
+    out.value<uint64_t>(hash);
+  }
+
+  FILE *movie_fp = fopen(movie_file.c_str(), "wb");
+  if (movie_fp == NULL) {
+    return false;
+  }
+  size_t written = fwrite(buffer.data(), 1, buffer.size(), movie_fp);
+  fclose(movie_fp);
+  return written == buffer.size();
+}
+
+bool Movie::load(const std::string &movie_file) {
+  FILE *movie_fp = fopen(movie_file.c_str(), "rb");
+  if (movie_fp == NULL) {
+    return false;
+  }
+  std::vector<uint8_t> buffer;
+  uint8_t chunk[4096];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), movie_fp)) > 0) {
+    buffer.insert(buffer.end(), chunk, chunk + n);
+  }
+  fclose(movie_fp);
+
+  StateReader in(buffer.data(), buffer.size());
+  uint32_t magic = in.value<uint32_t>();
+  uint32_t version = in.value<uint32_t>();
+  if (magic != MOVIE_MAGIC || version != MOVIE_VERSION) {
+    return false;
+  }
+  rom_hash = in.value<uint64_t>();
+  frames = in.value<uint32_t>();
+  hash_interval = in.value<uint32_t>();
+  uint32_t num_runs = in.value<uint32_t>();
+  uint32_t num_hashes = in.value<uint32_t>();
+  if (hash_interval == 0 || !in.ok()) {
+    return false;
+  }
+
+  runs.clear();
+  hashes.clear();
+  // one hash before every hash frame, see is_hash_frame
+  if (num_hashes != frames / hash_interval + (frames % hash_interval != 0)) {
+    return false;
+  }
+  uint64_t run_frames = 0;
+  for (uint32_t i = 0; i < num_runs && in.ok(); i++) {
+    uint32_t length = in.varint();
+    runs.emplace_back(length, in.value<uint8_t>());
+    run_frames += length;
+  }
+  for (uint32_t i = 0; i < num_hashes && in.ok(); i++) {
+    hashes.push_back(in.value<uint64_t>());
+  }
+  run = 0;
+  run_frame = 0;
+  return in.ok() && run_frames == frames;
+}
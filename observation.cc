@@ -0,0 +1,61 @@
+#include "observation.hh"
+#include "constants.hh"
+
+// turns a tile map entry into a tile number, whichever addressing mode is on
+static uint16_t tile_number(uint8_t index, bool unsigned_data) {
+  return unsigned_data ? index : 256 + (int8_t)index;
+}
+
+void observe(const Memory &mmu, Observation &obs) {
+  uint8_t lcdc = mmu.peek_byte(LCD_CONTROL);
+  obs.lcdc = lcdc;
+  obs.scx = mmu.peek_byte(SCX);
+  obs.scy = mmu.peek_byte(SCY);
+  obs.wx = mmu.peek_byte(WIN_X);
+  obs.wy = mmu.peek_byte(WIN_Y);
+
+  bool bg_win_enable = (lcdc >> BG_WIN_ENABLE) & 1;
+  bool win_enable = bg_win_enable && ((lcdc >> WIN_ENABLE) & 1);
+  bool unsigned_data = (lcdc >> TILE_DATA) & 1;
+  uint16_t bg_map = ((lcdc >> BG_TILE_MAP) & 1) ? 0x9C00 : 0x9800;
+  uint16_t win_map = ((lcdc >> WIN_TILE_MAP) & 1) ? 0x9C00 : 0x9800;
+  int win_left = obs.wx - 7;
+
+  for (int row = 0; row < OBS_HEIGHT; row++) {
+    int y = row * 8;
+    for (int col = 0; col < OBS_WIDTH; col++) {
+      int x = col * 8;
+      uint16_t map_addr;
+      if (!bg_win_enable) {
+        obs.tiles[row][col] = OBS_NO_TILE;
+        continue;
+      } else if (win_enable && y >= obs.wy && x >= win_left) {
+        map_addr = win_map + (((y - obs.wy) >> 3) << 5) + ((x - win_left) >> 3);
+      } else {
+        uint8_t bg_x = (x + obs.scx) & 0xFF;
+        uint8_t bg_y = (y + obs.scy) & 0xFF;
+        map_addr = bg_map + ((bg_y >> 3) << 5) + (bg_x >> 3);
+      }
+      obs.tiles[row][col] = tile_number(mmu.peek_byte(map_addr), unsigned_data);
+    }
+  }
+
+  obs.num_sprites = 0;
+  if (((lcdc >> OBJ_ENABLE) & 1) == 0) {
+    return;
+  }
+  int16_t height = ((lcdc >> OBJ_SIZE) & 1) ? 16 : 8;
+  for (int i = 0; i < 40; i++) {
+    uint16_t addr = OAM_START + (i * 4);
+    int16_t y = mmu.peek_byte(addr) - 16;
+    int16_t x = mmu.peek_byte(addr + 1) - 8;
+    if (y <= -height || y >= SCREEN_HEIGHT || x <= -8 || x >= SCREEN_WIDTH) {
+      continue;
+    }
+    uint8_t tile_index = mmu.peek_byte(addr + 2);
+    if (height == 16) {
+      tile_index &= 0xFE;
+    }
+    obs.sprites[obs.num_sprites++] = {x, y, tile_index, mmu.peek_byte(addr + 3)};
+  }
+}
@@ -0,0 +1,149 @@
+#include "opcode_stats.hh"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static const char *mnemonics[0x100] = {
+    // 0x00
+    "NOP", "LD BC,n16", "LD (BC),A", "INC BC", "INC B", "DEC B", "LD B,n8",
+    "RLCA", "LD (n16),SP", "ADD HL,BC", "LD A,(BC)", "DEC BC", "INC C",
+    "DEC C", "LD C,n8", "RRCA",
+    // 0x10
+    "STOP", "LD DE,n16", "LD (DE),A", "INC DE", "INC D", "DEC D", "LD D,n8",
+    "RLA", "JR e8", "ADD HL,DE", "LD A,(DE)", "DEC DE", "INC E", "DEC E",
+    "LD E,n8", "RRA",
+    // 0x20
+    "JR NZ,e8", "LD HL,n16", "LD (HL+),A", "INC HL", "INC H", "DEC H",
+    "LD H,n8", "DAA", "JR Z,e8", "ADD HL,HL", "LD A,(HL+)", "DEC HL", "INC L",
+    "DEC L", "LD L,n8", "CPL",
+    // 0x30
+    "JR NC,e8", "LD SP,n16", "LD (HL-),A", "INC SP", "INC (HL)", "DEC (HL)",
+    "LD (HL),n8", "SCF", "JR C,e8", "ADD HL,SP", "LD A,(HL-)", "DEC SP",
+    "INC A", "DEC A", "LD A,n8", "CCF",
+    // 0x40 - 0xBF are regular and filled in by name()
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    // 0xC0
+    "RET NZ", "POP BC", "JP NZ,n16", "JP n16", "CALL NZ,n16", "PUSH BC",
+    "ADD A,n8", "RST 00", "RET Z", "RET", "JP Z,n16", "PREFIX", "CALL Z,n16",
+    "CALL n16", "ADC A,n8", "RST 08",
+    // 0xD0
+    "RET NC", "POP DE", "JP NC,n16", "-", "CALL NC,n16", "PUSH DE",
+    "SUB A,n8", "RST 10", "RET C", "RETI", "JP C,n16", "-", "CALL C,n16", "-",
+    "SBC A,n8", "RST 18",
+    // 0xE0
+    "LDH (n8),A", "POP HL", "LDH (C),A", "-", "-", "PUSH HL", "AND A,n8",
+    "RST 20", "ADD SP,e8", "JP HL", "LD (n16),A", "-", "-", "-", "XOR A,n8",
+    "RST 28",
+    // 0xF0
+    "LDH A,(n8)", "POP AF", "LDH A,(C)", "DI", "-", "PUSH AF", "OR A,n8",
+    "RST 30", "LD HL,SP+e8", "LD SP,HL", "LD A,(n16)", "EI", "-", "-",
+    "CP A,n8", "RST 38",
+};
+
+static const char *registers[8] = {"B", "C", "D", "E", "H", "L", "(HL)", "A"};
+
+static std::string name(uint16_t index) {
+  uint8_t opcode = index & 0xFF;
+  const char *src = registers[opcode & 7];
+  if (index >= 0x100) {
+    static const char *shifts[8] = {"RLC", "RRC", "RL",   "RR",
+                                    "SLA", "SRA", "SWAP", "SRL"};
+    static const char *bit_ops[4] = {NULL, "BIT", "RES", "SET"};
+    if (opcode < 0x40) {
+      return std::string(shifts[opcode >> 3]) + " " + src;
+    }
+    return std::string(bit_ops[opcode >> 6]) + " " +
+           std::to_string((opcode >> 3) & 7) + "," + src;
+  }
+  if (mnemonics[opcode] != NULL) {
+    return mnemonics[opcode];
+  }
+  if (opcode == 0x76) {
+    return "HALT";
+  }
+  if (opcode < 0x80) {
+    return std::string("LD ") + registers[(opcode >> 3) & 7] + "," + src;
+  }
+  static const char *alu[8] = {"ADD A,", "ADC A,", "SUB A,", "SBC A,",
+                               "AND A,", "XOR A,", "OR A,",  "CP A,"};
+  return std::string(alu[(opcode >> 3) & 7]) + src;
+}
+
+OpcodeStats::OpcodeStats() {
+  memset(counts, 0, sizeof(counts));
+  memset(cycles, 0, sizeof(cycles));
+  until_sample = OPCODE_SAMPLE_INTERVAL;
+}
+
+void OpcodeStats::print() const {
+  uint64_t total_count = 0, total_cycles = 0;
+  std::vector<uint16_t> executed;
+  for (uint16_t index = 0; index < OPCODE_STATS_SIZE; index++) {
+    total_count += counts[index];
+    total_cycles += cycles[index];
+    if (counts[index] > 0) {
+      executed.push_back(index);
+    }
+  }
+  if (total_count == 0) {
+    return;
+  }
+  fprintf(stderr, "Executed %llu instructions (%zu distinct opcodes) in %llu "
+                  "cycles\n",
+          (unsigned long long)total_count, executed.size(),
+          (unsigned long long)total_cycles);
+
+  const char *orders[2] = {"executions", "cycles"};
+  for (int order = 0; order < 2; order++) {
+    const uint64_t *key = order == 0 ? counts : cycles;
+    std::stable_sort(executed.begin(), executed.end(),
+                     [key](uint16_t a, uint16_t b) { return key[a] > key[b]; });
+    fprintf(stderr, "\nTop opcodes by %s:\n  %-6s %-14s %14s %7s %16s %7s\n",
+            orders[order], "opcode", "mnemonic", "executions", "%", "cycles",
+            "%");
+    for (size_t i = 0; i < executed.size() && i < OPCODE_REPORT_ROWS; i++) {
+      uint16_t index = executed[i];
+      char opcode[8];
+      snprintf(opcode, sizeof(opcode), index >= 0x100 ? "CB %02X" : "%02X",
+               index & 0xFF);
+      fprintf(stderr, "  %-6s %-14s %14llu %6.2f%% %16llu %6.2f%%\n", opcode,
+              name(index).c_str(), (unsigned long long)counts[index],
+              100.0 * counts[index] / total_count,
+              (unsigned long long)cycles[index],
+              100.0 * cycles[index] / total_cycles);
+    }
+  }
+
+  uint64_t total_samples = 0;
+  std::vector<std::pair<uint32_t, uint64_t>> hot(pc_samples.begin(),
+                                                 pc_samples.end());
+  for (const std::pair<uint32_t, uint64_t> &sample : hot) {
+    total_samples += sample.second;
+  }
+  std::sort(hot.begin(), hot.end(),
+            [](const std::pair<uint32_t, uint64_t> &a,
+               const std::pair<uint32_t, uint64_t> &b) {
+              return a.second > b.second ||
+                     (a.second == b.second && a.first < b.first);
+            });
+  fprintf(stderr, "\nHottest addresses (1 in %d instructions sampled):\n"
+                  "  %-9s %10s %7s\n",
+          OPCODE_SAMPLE_INTERVAL, "bank:pc", "samples", "%");
+  for (size_t i = 0; i < hot.size() && i < OPCODE_REPORT_ROWS; i++) {
+    fprintf(stderr, "  %02X:%04X   %10llu %6.2f%%\n", hot[i].first >> 16,
+            hot[i].first & 0xFFFF, (unsigned long long)hot[i].second,
+            100.0 * hot[i].second / total_samples);
+  }
+}
@@ -0,0 +1,108 @@
+#include "pacer.hh"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+FramePacer::FramePacer() {
+  period = 0;
+  deadline = 0;
+  last_frame = 0;
+  vsync_locked = false;
+  vsync_time = 0;
+  vsync_period = 0;
+  frame_times.reserve(PACER_SAMPLES);
+  next_sample = 0;
+}
+
+void FramePacer::set_period(double period_ms) {
+  period = (int64_t)(period_ms * 1000000.0);
+}
+
+void FramePacer::reset() {
+  deadline = 0;
+  last_frame = 0;
+}
+
+void FramePacer::lock_to_vsync(int64_t vsync_time, int64_t vsync_period) {
+  vsync_locked = true;
+  this->vsync_time = vsync_time;
+  this->vsync_period = vsync_period;
+}
+
+PacerWait FramePacer::wait() {
+  PacerWait result = {false, 0, 0};
+  int64_t now = monotonic_ns();
+  int64_t step = period;
+  if (vsync_locked && vsync_time != 0 &&
+      std::abs(vsync_period - period) < period * VSYNC_LOCK_TOLERANCE) {
+    step = vsync_period;
+    if (deadline != 0) {
+      // pull the schedule a sixteenth of the way towards mid refresh each
+      // frame, so it follows the display without visible jumps
+      int64_t phase = ((deadline - vsync_time) % step + step) % step;
+      deadline -= (phase - step / 2) / 16;
+    }
+  }
+
+  if (deadline != 0 && now >= deadline) {
+    result.late_ns = now - deadline;
+  }
+  if (deadline == 0 || now - deadline > PACER_MAX_LAG_NS) {
+    // first frame, or too far behind (a debugger, a suspended laptop) to
+    // catch up without a burst of fast frames
+    deadline = now;
+  }
+  result.waited = now < deadline;
+  if (deadline - now > PACER_SPIN_NS) {
+    int64_t wake = deadline - PACER_SPIN_NS;
+    struct timespec ts;
+    ts.tv_sec = wake / 1000000000LL;
+    ts.tv_nsec = wake % 1000000000LL;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0) {
+      // interrupted by a signal, sleep again
+    }
+  }
+  while ((now = monotonic_ns()) < deadline) {
+  }
+  if (result.waited) {
+    result.overshoot_ns = now - deadline;
+  }
+  deadline += step;
+
+  if (last_frame != 0) {
+    if (frame_times.size() < PACER_SAMPLES) {
+      frame_times.push_back(now - last_frame);
+    } else {
+      frame_times[next_sample] = now - last_frame;
+    }
+    next_sample = (next_sample + 1) % PACER_SAMPLES;
+  }
+  last_frame = now;
+  return result;
+}
+
+void FramePacer::print_stats() const {
+  if (frame_times.empty()) {
+    return;
+  }
+  std::vector<int64_t> times = frame_times;
+  std::sort(times.begin(), times.end());
+  // jitter is the distance from the median frame time
+  int64_t median = times[times.size() / 2];
+  std::vector<int64_t> jitter;
+  jitter.reserve(times.size());
+  for (int64_t t : times) {
+    jitter.push_back(std::abs(t - median));
+  }
+  std::sort(jitter.begin(), jitter.end());
+  auto percentile = [](const std::vector<int64_t> &v, double p) {
+    return v[std::min(v.size() - 1, (size_t)(p * v.size()))] / 1e6;
+  };
+  fprintf(stderr,
+          "Frame time over %zu frames: p50 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+          times.size(), percentile(times, 0.5), percentile(times, 0.99),
+          times.back() / 1e6);
+  fprintf(stderr, "Frame jitter: p50 %.3f ms, p90 %.3f ms, p99 %.3f ms\n",
+          percentile(jitter, 0.5), percentile(jitter, 0.9),
+          percentile(jitter, 0.99));
+}
@@ -0,0 +1,78 @@
+#include "profiler.hh"
+
+#ifdef GB_PROFILE
+
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+thread_local ProfileThread profile_thread;
+
+static const char *zone_names[NUM_ZONES] = {
+    "other",  "cpu",   "timer",  "ppu",   "draw",   "render",  "hooks",
+    "input",  "rewind", "state", "sleep", "upload", "present",
+    "poll",
+};
+
+static std::mutex totals_lock;
+static uint64_t totals[NUM_ZONES];
+
+// emulation thread only
+static uint32_t report_frames;
+static int64_t report_start_ns;
+static uint64_t report_start_ticks;
+
+void profile_flush() {
+  // charge the running zone up to now so nothing is lost at the cut
+  profile_switch(profile_thread.current);
+  std::lock_guard<std::mutex> guard(totals_lock);
+  for (int zone = 0; zone < NUM_ZONES; zone++) {
+    totals[zone] += profile_thread.ticks[zone];
+  }
+  memset(profile_thread.ticks, 0, sizeof(profile_thread.ticks));
+}
+
+void profile_frame() {
+  profile_flush();
+  report_frames++;
+  int64_t now_ns = monotonic_ns();
+  uint64_t now_ticks = read_ticks();
+  if (report_start_ns == 0) {
+    // the first frame only starts the clock
+    std::lock_guard<std::mutex> guard(totals_lock);
+    memset(totals, 0, sizeof(totals));
+    report_frames = 0;
+    report_start_ns = now_ns;
+    report_start_ticks = now_ticks;
+    return;
+  }
+  if (now_ns - report_start_ns < 1000000000LL) {
+    return;
+  }
+
+  double ms_per_tick =
+      (now_ns - report_start_ns) / 1e6 / (now_ticks - report_start_ticks);
+  double ms_per_frame = (now_ns - report_start_ns) / 1e6 / report_frames;
+  char line[512];
+  int length = snprintf(line, sizeof(line), "Profile: %u fps, %.2f ms/frame |",
+                        report_frames, ms_per_frame);
+  {
+    std::lock_guard<std::mutex> guard(totals_lock);
+    for (int zone = 0; zone < NUM_ZONES; zone++) {
+      if (zone == ZONE_UPLOAD) {
+        length += snprintf(line + length, sizeof(line) - length, " | display");
+      }
+      length += snprintf(line + length, sizeof(line) - length, " %s %.2f",
+                         zone_names[zone],
+                         totals[zone] * ms_per_tick / report_frames);
+    }
+    memset(totals, 0, sizeof(totals));
+  }
+  fprintf(stderr, "%s ms/frame\n", line);
+
+  report_frames = 0;
+  report_start_ns = now_ns;
+  report_start_ticks = now_ticks;
+}
+
+#endif
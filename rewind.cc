@@ -0,0 +1,236 @@
+#include "rewind.hh"
+#include "gameboy.hh"
+#include "savestate.hh"
+
+// delta format: repeated (unchanged byte count, changed byte count, xor of
+// each changed byte with the keyframe) until the end of the state
+static void encode_delta(const std::vector<uint8_t> &state,
+                         const std::vector<uint8_t> &key,
+                         std::vector<uint8_t> &encoded) {
+  StateWriter out(encoded);
+  size_t n = state.size();
+  size_t i = 0;
+  while (i < n) {
+    size_t start = i;
+    while (i < n && state[i] == key[i]) {
+      i++;
+    }
+    out.varint(i - start);
+    start = i;
+    while (i < n && state[i] != key[i]) {
+      i++;
+    }
+    out.varint(i - start);
+    for (size_t j = start; j < i; j++) {
+      out.value<uint8_t>(state[j] ^ key[j]);
+    }
+  }
+}
+
+// applies a delta on top of a copy of its keyframe. false if the delta runs
+// past the end of the state
+static bool apply_delta(const std::vector<uint8_t> &delta,
+                        std::vector<uint8_t> &state) {
+  StateReader in(delta.data(), delta.size());
+  size_t pos = 0;
+  while (in.remaining() > 0) {
+    pos += in.varint();
+    uint32_t changed = in.varint();
+    if (!in.ok() || pos > state.size() || changed > state.size() - pos) {
+      return false;
+    }
+    for (uint32_t i = 0; i < changed; i++) {
+      state[pos++] ^= in.value<uint8_t>();
+    }
+  }
+  return in.ok();
+}
+
+RewindBuffer::RewindBuffer() : entries(REWIND_CAPACITY) {
+  head = 0;
+  count = 0;
+  for (Entry &entry : entries) {
+    entry.key_slot = -1;
+  }
+  for (int i = 0; i < REWIND_PENDING_SLOTS; i++) {
+    free_slots.push_back(i);
+    slot_frame[i] = 0;
+  }
+  ready_slots.reserve(REWIND_PENDING_SLOTS);
+  keyframe_frame = 0;
+  force_keyframe = true;
+  frame = 0;
+  dropped = 0;
+  busy = false;
+  shutdown = false;
+  worker = std::thread(&RewindBuffer::worker_loop, this);
+}
+
+RewindBuffer::~RewindBuffer() {
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    shutdown = true;
+  }
+  work_ready.notify_one();
+  worker.join();
+}
+
+void RewindBuffer::push(const Gameboy &gameboy) {
+  int slot;
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    if (free_slots.empty()) {
+      dropped++;
+      frame++;
+      return;
+    }
+    slot = free_slots.back();
+    free_slots.pop_back();
+  }
+
+  // the slot belongs to this thread until it is marked ready
+  gameboy.save_state(slots[slot]);
+
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    slot_frame[slot] = frame++;
+    ready_slots.push_back(slot);
+  }
+  work_ready.notify_one();
+}
+
+bool RewindBuffer::rewind(Gameboy &gameboy) {
+  std::unique_lock<std::mutex> guard(lock);
+  // let the worker finish compressing what was pushed
+  work_done.wait(guard, [this] { return ready_slots.empty() && !busy; });
+
+  while (count > 0) {
+    size_t newest = (head + entries.size() - 1) % entries.size();
+    Entry &entry = entries[newest];
+    bool decoded = true;
+    if (entry.is_keyframe) {
+      scratch = keyframes[entry.key_slot];
+    } else {
+      const Entry *key = find_keyframe(entry);
+      if (key != NULL) {
+        scratch = keyframes[key->key_slot];
+        decoded = apply_delta(entry.data, scratch);
+      } else {
+        decoded = false;
+      }
+    }
+    release(entry);
+    head = newest;
+    count--;
+
+    if (decoded) {
+      // the keyframe new frames would be encoded against may be gone now
+      force_keyframe = true;
+      guard.unlock();
+      return gameboy.load_state(scratch.data(), scratch.size());
+    }
+  }
+  return false;
+}
+
+size_t RewindBuffer::size() {
+  std::lock_guard<std::mutex> guard(lock);
+  return count;
+}
+
+void RewindBuffer::worker_loop() {
+  std::vector<uint8_t> encoded;
+  std::unique_lock<std::mutex> guard(lock);
+  while (true) {
+    work_ready.wait(guard,
+                    [this] { return shutdown || !ready_slots.empty(); });
+    if (shutdown) {
+      return;
+    }
+    int slot = ready_slots.front();
+    ready_slots.erase(ready_slots.begin());
+    uint64_t slot_frame_number = slot_frame[slot];
+    bool key = force_keyframe;
+    force_keyframe = false;
+    busy = true;
+    guard.unlock();
+
+    const std::vector<uint8_t> &state = slots[slot];
+    if (key || keyframe.size() != state.size() ||
+        slot_frame_number - keyframe_frame >= REWIND_KEYFRAME_INTERVAL) {
+      key = true;
+      keyframe = state;
+      keyframe_frame = slot_frame_number;
+    } else {
+      encode_delta(state, keyframe, encoded);
+    }
+
+    guard.lock();
+    Entry &entry = insert();
+    entry.frame = slot_frame_number;
+    entry.keyframe = keyframe_frame;
+    entry.is_keyframe = key;
+    if (key) {
+      if (free_keyframes.empty()) {
+        free_keyframes.push_back(keyframes.size());
+        keyframes.emplace_back();
+      }
+      entry.key_slot = free_keyframes.back();
+      free_keyframes.pop_back();
+      keyframes[entry.key_slot] = keyframe;
+      entry.data.clear();
+    } else {
+      // copying keeps each buffer's capacity at the size of its own deltas
+      entry.key_slot = -1;
+      entry.data.assign(encoded.begin(), encoded.end());
+    }
+    free_slots.push_back(slot);
+    busy = false;
+    work_done.notify_all();
+  }
+}
+
+// claims the slot after the newest entry, evicting old history if full
+RewindBuffer::Entry &RewindBuffer::insert() {
+  if (count == entries.size()) {
+    evict_oldest();
+  }
+  Entry &entry = entries[head];
+  head = (head + 1) % entries.size();
+  count++;
+  return entry;
+}
+
+// removes the oldest entry, along with any deltas it leaves without a keyframe
+void RewindBuffer::evict_oldest() {
+  release(entries[(head + entries.size() - count) % entries.size()]);
+  count--;
+  while (count > 0) {
+    size_t oldest = (head + entries.size() - count) % entries.size();
+    if (entries[oldest].is_keyframe) {
+      break;
+    }
+    release(entries[oldest]);
+    count--;
+  }
+}
+
+// hands a keyframe's buffer back to the pool once its entry is gone
+void RewindBuffer::release(Entry &entry) {
+  if (entry.key_slot >= 0) {
+    free_keyframes.push_back(entry.key_slot);
+    entry.key_slot = -1;
+  }
+}
+
+const RewindBuffer::Entry *
+RewindBuffer::find_keyframe(const Entry &entry) const {
+  for (size_t i = 1; i <= count; i++) {
+    const Entry &candidate =
+        entries[(head + entries.size() - i) % entries.size()];
+    if (candidate.is_keyframe && candidate.frame == entry.keyframe) {
+      return &candidate;
+    }
+  }
+  return NULL;
+}
@@ -0,0 +1,61 @@
+#include "savestate.hh"
+#include <cstring>
+
+StateWriter::StateWriter(std::vector<uint8_t> &b) : buffer(b) {
+  buffer.clear();
+}
+
+void StateWriter::write(const void *data, size_t size) {
+  const uint8_t *bytes = (const uint8_t *)data;
+  buffer.insert(buffer.end(), bytes, bytes + size);
+}
+
+void StateWriter::patch_u32(size_t offset, uint32_t value) {
+  for (size_t i = 0; i < 4; i++) {
+    buffer[offset + i] = value >> (i * 8);
+  }
+}
+
+void StateWriter::varint(uint32_t value) {
+  while (value >= 0x80) {
+    buffer.push_back((value & 0x7F) | 0x80);
+    value >>= 7;
+  }
+  buffer.push_back(value);
+}
+
+size_t StateWriter::size() const { return buffer.size(); }
+
+StateReader::StateReader(const uint8_t *d, size_t s) : data(d), size(s) {
+  pos = 0;
+  failed = false;
+}
+
+void StateReader::read(void *dst, size_t n) {
+  if (failed || n > size - pos) {
+    failed = true;
+    memset(dst, 0, n);
+    return;
+  }
+  memcpy(dst, data + pos, n);
+  pos += n;
+}
+
+uint32_t StateReader::varint() {
+  uint32_t value = 0;
+  for (int shift = 0;; shift += 7) {
+    uint8_t byte = this->value<uint8_t>();
+    if (shift == 28 && byte > 0x0F) {
+      failed = true;
+      return 0;
+    }
+    value |= (uint32_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      return value;
+    }
+  }
+}
+
+size_t StateReader::remaining() const { return size - pos; }
+
+bool StateReader::ok() const { return !failed; }
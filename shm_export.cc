@@ -0,0 +1,89 @@
+#include "shm_export.hh"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
+
+ShmExporter::ShmExporter(
+    const std::string &name, const Memory &mmu, const Joypad &joypad,
+    const std::vector<std::pair<uint16_t, uint16_t>> &ranges)
+    : name(name), mmu(mmu), joypad(joypad) {
+  if (ranges.size() > SHM_MAX_RANGES) {
+    std::cerr << "At most " << SHM_MAX_RANGES << " ram ranges can be exported"
+              << std::endl;
+    exit(1);
+  }
+  ram_size = 0;
+  for (const std::pair<uint16_t, uint16_t> &r : ranges) {
+    this->ranges.push_back({r.first, r.second});
+    ram_size += r.second;
+  }
+  // keep every slot on its own cache lines
+  slot_size = (sizeof(ShmSlot) + ram_size + 63) & ~(size_t)63;
+  map_size = sizeof(ShmHeader) + SHM_SLOTS * slot_size;
+  frame = 0;
+
+  int fd = shm_open(name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+  if (fd < 0 || ftruncate(fd, map_size) != 0) {
+    std::cerr << "Could not create shared memory " << name << std::endl;
+    exit(1);
+  }
+  void *addr =
+      mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    std::cerr << "Could not map shared memory " << name << std::endl;
+    exit(1);
+  }
+  map = (uint8_t *)addr;
+
+  header = new (map) ShmHeader();
+  for (int i = 0; i < SHM_SLOTS; i++) {
+    new (slot(i)) ShmSlot();
+    slot(i)->seq.store(0, std::memory_order_relaxed);
+  }
+  header->version = SHM_VERSION;
+  header->slots = SHM_SLOTS;
+  header->slot_size = slot_size;
+  header->ram_size = ram_size;
+  header->num_ranges = this->ranges.size();
+  std::copy(this->ranges.begin(), this->ranges.end(), header->ranges);
+  header->latest.store(0, std::memory_order_relaxed);
+  // readers check the magic last, so a half initialized header is never used
+  std::atomic_thread_fence(std::memory_order_release);
+  header->magic = SHM_MAGIC;
+}
+
+ShmExporter::~ShmExporter() {
+  munmap(map, map_size);
+  shm_unlink(name.c_str());
+}
+
+ShmSlot *ShmExporter::slot(uint64_t frame) {
+  return (ShmSlot *)(map + sizeof(ShmHeader) +
+                     (frame % SHM_SLOTS) * slot_size);
+}
+
+void ShmExporter::publish(const uint8_t *screen, bool rendered) {
+  ShmSlot *s = slot(frame);
+  s->seq.store(2 * frame + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  s->frame = frame;
+  s->buttons = joypad.get_buttons();
+  s->rendered = rendered;
+  memcpy(s->screen, screen, sizeof(s->screen));
+  uint8_t *ram = (uint8_t *)(s + 1);
+  for (const ShmRange &r : ranges) {
+    for (uint32_t i = 0; i < r.length; i++) {
+      *ram++ = mmu.peek_byte(r.start + i);
+    }
+  }
+
+  s->seq.store(2 * frame + 2, std::memory_order_release);
+  header->latest.store(frame + 1, std::memory_order_release);
+  frame++;
+}
@@ -1,5 +1,6 @@
 #include "timer.hh"
 #include "constants.hh"
+#include "trace.hh"
 
 Timer::Timer(Memory& m) : mmu(m){
   div = 0;
@@ -52,6 +53,9 @@ void Timer::tick() {
     tima++;
     if (tima == 0) {
       tima = tma;
+      if (mmu.get_trace() != NULL) {
+        mmu.get_trace()->record(TRACE_TIMER_OVERFLOW);
+      }
       mmu.request_interrupt(TIMER_INTER);
     }
   }
@@ -59,3 +63,21 @@ void Timer::tick() {
 
   div++;
 }
+
+void Timer::save_state(StateWriter &state) const {
+  state.value<uint16_t>(div);
+  state.value<uint8_t>(tima);
+  state.value<uint8_t>(tma);
+  state.value<uint8_t>(tac);
+  state.value<uint8_t>(prev_and_result);
+  state.value<int8_t>(tima_overflow);
+}
+
+void Timer::load_state(StateReader &state) {
+  div = state.value<uint16_t>();
+  tima = state.value<uint8_t>();
+  tma = state.value<uint8_t>();
+  tac = state.value<uint8_t>();
+  prev_and_result = state.value<uint8_t>();
+  tima_overflow = state.value<int8_t>();
+}
@@ -0,0 +1,187 @@
+#include "trace.hh"
+#include "constants.hh"
+#include <chrono>
+#include <iostream>
+
+// tracks (chrome trace thread ids)
+enum {
+  TRACK_CPU = 1,
+  TRACK_PPU,
+  TRACK_INTERRUPTS,
+  TRACK_TIMER,
+  TRACK_MBC,
+  TRACK_DMA,
+};
+
+static const char *track_names[] = {NULL,     "CPU",   "PPU", "Interrupts",
+                                    "Timer", "MBC", "DMA"};
+static const char *mode_names[4] = {"HBlank", "VBlank", "OAM scan", "Draw"};
+static const char *interrupt_names[5] = {"VBlank", "STAT", "Timer", "Serial",
+                                         "Joypad"};
+
+// chrome traces count in microseconds
+static double micros(uint64_t cycle) { return cycle * 1e6 / CYCLES_PER_SECOND; }
+
+TraceRecorder::TraceRecorder(const std::string &file_name) {
+  file = fopen(file_name.c_str(), "w");
+  if (file == NULL) {
+    std::cerr << "Could not create " << file_name << std::endl;
+    exit(1);
+  }
+  head.store(0, std::memory_order_relaxed);
+  tail.store(0, std::memory_order_relaxed);
+  now = 0;
+  tail_seen = 0;
+  dropped = 0;
+  written = 0;
+  lcd_on = false;
+  mode = 0;
+  mode_start = 0;
+  halted = false;
+  halt_start = 0;
+  last_cycle = 0;
+
+  out.reserve(TRACE_WRITE_SIZE + 4096);
+  out += "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+  char line[160];
+  for (int track = TRACK_CPU; track <= TRACK_DMA; track++) {
+    snprintf(line, sizeof(line),
+             "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+             "\"args\":{\"name\":\"%s\"}},\n",
+             track, track_names[track]);
+    out += line;
+  }
+
+  shutdown.store(false, std::memory_order_relaxed);
+  writer = std::thread(&TraceRecorder::writer_loop, this);
+}
+
+TraceRecorder::~TraceRecorder() {
+  shutdown.store(true, std::memory_order_release);
+  writer.join();
+  drain();
+  // close whatever is still open
+  if (lcd_on) {
+    slice(mode_names[mode], TRACK_PPU, mode_start, last_cycle);
+  }
+  if (halted) {
+    slice("HALT", TRACK_CPU, halt_start, last_cycle);
+  }
+  // every event line ends in a comma, so a last one closes the list
+  char line[160];
+  snprintf(line, sizeof(line),
+           "{\"name\":\"end\",\"ph\":\"i\",\"s\":\"g\",\"ts\":%.3f,\"pid\":1,"
+           "\"tid\":%d}\n]}\n",
+           micros(last_cycle), TRACK_CPU);
+  out += line;
+  flush();
+  fclose(file);
+  std::cerr << "Traced " << written << " events, dropped " << dropped
+            << std::endl;
+}
+
+void TraceRecorder::writer_loop() {
+  while (!shutdown.load(std::memory_order_acquire)) {
+    std::this_thread::sleep_for(
+        std::chrono::milliseconds(TRACE_DRAIN_INTERVAL_MS));
+    drain();
+  }
+}
+
+void TraceRecorder::drain() {
+  uint64_t t = tail.load(std::memory_order_relaxed);
+  uint64_t h = head.load(std::memory_order_acquire);
+  for (; t < h; t++) {
+    write_event(ring[t & (TRACE_RING_SIZE - 1)]);
+    written++;
+  }
+  tail.store(t, std::memory_order_release);
+  if (out.size() >= TRACE_WRITE_SIZE) {
+    flush();
+  }
+}
+
+void TraceRecorder::write_event(const TraceEvent &event) {
+  char name[32];
+  last_cycle = event.cycle;
+  switch (event.type) {
+  case TRACE_PPU_MODE:
+    if (lcd_on) {
+      slice(mode_names[mode], TRACK_PPU, mode_start, event.cycle);
+    }
+    mode = event.arg & 3;
+    mode_start = event.cycle;
+    lcd_on = true;
+    break;
+  case TRACE_LCD_ON:
+    instant("LCD on", TRACK_PPU, event.cycle);
+    break;
+  case TRACE_LCD_OFF:
+    if (lcd_on) {
+      slice(mode_names[mode], TRACK_PPU, mode_start, event.cycle);
+    }
+    lcd_on = false;
+    instant("LCD off", TRACK_PPU, event.cycle);
+    break;
+  case TRACE_INTERRUPT_REQUEST:
+    snprintf(name, sizeof(name), "request %s", interrupt_names[event.arg % 5]);
+    instant(name, TRACK_INTERRUPTS, event.cycle);
+    break;
+  case TRACE_INTERRUPT_SERVICE:
+    snprintf(name, sizeof(name), "service %s", interrupt_names[event.arg % 5]);
+    instant(name, TRACK_CPU, event.cycle);
+    break;
+  case TRACE_HALT_ENTER:
+    halted = true;
+    halt_start = event.cycle;
+    break;
+  case TRACE_HALT_EXIT:
+    if (halted) {
+      slice("HALT", TRACK_CPU, halt_start, event.cycle);
+    }
+    halted = false;
+    break;
+  case TRACE_DMA:
+    // 160 m-cycles
+    snprintf(name, sizeof(name), "OAM DMA from %02X00", event.arg);
+    slice(name, TRACK_DMA, event.cycle, event.cycle + 640);
+    break;
+  case TRACE_ROM_BANK:
+    snprintf(name, sizeof(name), "ROM bank %d", event.arg);
+    instant(name, TRACK_MBC, event.cycle);
+    break;
+  case TRACE_RAM_BANK:
+    snprintf(name, sizeof(name), "RAM bank %d", event.arg);
+    instant(name, TRACK_MBC, event.cycle);
+    break;
+  case TRACE_TIMER_OVERFLOW:
+    instant("TIMA overflow", TRACK_TIMER, event.cycle);
+    break;
+  }
+}
+
+void TraceRecorder::slice(const char *name, int track, uint64_t start,
+                          uint64_t end) {
+  char line[192];
+  snprintf(line, sizeof(line),
+           "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,"
+           "\"tid\":%d},\n",
+           name, micros(start), micros(end - start), track);
+  out += line;
+}
+
+void TraceRecorder::instant(const char *name, int track, uint64_t cycle) {
+  char line[192];
+  snprintf(line, sizeof(line),
+           "{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,"
+           "\"tid\":%d},\n",
+           name, micros(cycle), track);
+  out += line;
+}
+
+void TraceRecorder::flush() {
+  if (!out.empty() && fwrite(out.data(), 1, out.size(), file) != out.size()) {
+    std::cerr << "Could not write trace" << std::endl;
+  }
+  out.clear();
+}
@@ -0,0 +1,216 @@
+#include "upscale.hh"
+#include "convert.hh"
+#include "gpu.hh"
+#include "pacer.hh"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define PADDED_WIDTH (SCREEN_WIDTH + 2)
+
+// copies a row with its edge pixels repeated on both sides, so neighbours
+// can be read without bounds checks
+static void pad_row(const uint8_t *row, uint8_t *padded) {
+  padded[0] = row[0];
+  memcpy(padded + 1, row, SCREEN_WIDTH);
+  padded[SCREEN_WIDTH + 1] = row[SCREEN_WIDTH - 1];
+}
+
+// one input row to two output rows. b, e and h are the padded rows above, at
+// and below the pixel (B, E, H) and D and F are E's left and right neighbours
+static void scale2x_row(const uint8_t *b, const uint8_t *e, const uint8_t *h,
+                        uint8_t *out0, uint8_t *out1) {
+#ifdef __SSE2__
+  static_assert(SCREEN_WIDTH % 16 == 0, "rows are whole vectors");
+  const __m128i ones = _mm_set1_epi8(-1);
+  for (int x = 0; x < SCREEN_WIDTH; x += 16) {
+    __m128i B = _mm_loadu_si128((const __m128i *)(b + x + 1));
+    __m128i H = _mm_loadu_si128((const __m128i *)(h + x + 1));
+    __m128i D = _mm_loadu_si128((const __m128i *)(e + x));
+    __m128i E = _mm_loadu_si128((const __m128i *)(e + x + 1));
+    __m128i F = _mm_loadu_si128((const __m128i *)(e + x + 2));
+    __m128i edge = _mm_andnot_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(B, H), _mm_cmpeq_epi8(D, F)), ones);
+    __m128i m0 = _mm_and_si128(edge, _mm_cmpeq_epi8(D, B));
+    __m128i m1 = _mm_and_si128(edge, _mm_cmpeq_epi8(B, F));
+    __m128i m2 = _mm_and_si128(edge, _mm_cmpeq_epi8(D, H));
+    __m128i m3 = _mm_and_si128(edge, _mm_cmpeq_epi8(H, F));
+    __m128i e0 = _mm_or_si128(_mm_and_si128(m0, D), _mm_andnot_si128(m0, E));
+    __m128i e1 = _mm_or_si128(_mm_and_si128(m1, F), _mm_andnot_si128(m1, E));
+    __m128i e2 = _mm_or_si128(_mm_and_si128(m2, D), _mm_andnot_si128(m2, E));
+    __m128i e3 = _mm_or_si128(_mm_and_si128(m3, F), _mm_andnot_si128(m3, E));
+    __m128i *o0 = (__m128i *)(out0 + 2 * x);
+    __m128i *o1 = (__m128i *)(out1 + 2 * x);
+    _mm_storeu_si128(o0, _mm_unpacklo_epi8(e0, e1));
+    _mm_storeu_si128(o0 + 1, _mm_unpackhi_epi8(e0, e1));
+    _mm_storeu_si128(o1, _mm_unpacklo_epi8(e2, e3));
+    _mm_storeu_si128(o1 + 1, _mm_unpackhi_epi8(e2, e3));
+  }
+#else
+  for (int x = 0; x < SCREEN_WIDTH; x++) {
+    uint8_t B = b[x + 1], H = h[x + 1];
+    uint8_t D = e[x], E = e[x + 1], F = e[x + 2];
+    bool edge = B != H && D != F;
+    out0[2 * x] = edge && D == B ? D : E;
+    out0[2 * x + 1] = edge && B == F ? F : E;
+    out1[2 * x] = edge && D == H ? D : E;
+    out1[2 * x + 1] = edge && H == F ? F : E;
+  }
+#endif
+}
+
+// one input row to three output rows, with the 3x3 neighbourhood
+//   A B C
+//   D E F
+//   G H I
+static void scale3x_row(const uint8_t *b, const uint8_t *e, const uint8_t *h,
+                        uint8_t *out0, uint8_t *out1, uint8_t *out2) {
+  for (int x = 0; x < SCREEN_WIDTH; x++) {
+    uint8_t A = b[x], B = b[x + 1], C = b[x + 2];
+    uint8_t D = e[x], E = e[x + 1], F = e[x + 2];
+    uint8_t G = h[x], H = h[x + 1], I = h[x + 2];
+    uint8_t *o0 = out0 + 3 * x, *o1 = out1 + 3 * x, *o2 = out2 + 3 * x;
+    if (B != H && D != F) {
+      o0[0] = D == B ? D : E;
+      o0[1] = (D == B && E != C) || (B == F && E != A) ? B : E;
+      o0[2] = B == F ? F : E;
+      o1[0] = (D == B && E != G) || (D == H && E != A) ? D : E;
+      o1[1] = E;
+      o1[2] = (B == F && E != I) || (H == F && E != C) ? F : E;
+      o2[0] = D == H ? D : E;
+      o2[1] = (D == H && E != I) || (H == F && E != G) ? H : E;
+      o2[2] = H == F ? F : E;
+    } else {
+      o0[0] = o0[1] = o0[2] = E;
+      o1[0] = o1[1] = o1[2] = E;
+      o2[0] = o2[1] = o2[2] = E;
+    }
+  }
+}
+
+Upscaler::Upscaler(upscale_filter filter, int num_threads) {
+  this->filter = filter;
+  scale = filter == FILTER_SCALE3X ? 3 : filter == FILTER_SCALE2X ? 2 : 1;
+  if (num_threads <= 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  num_bands = std::min(num_threads, SCREEN_HEIGHT);
+  frame = NULL;
+  dst = NULL;
+  pitch = 0;
+  generation = 0;
+  bands_left = 0;
+  shutdown = false;
+  costs.reserve(UPSCALE_SAMPLES);
+  next_cost = 0;
+  // band 0 belongs to the caller
+  for (int band = 1; band < num_bands; band++) {
+    workers.emplace_back(&Upscaler::worker_loop, this, band);
+  }
+}
+
+Upscaler::~Upscaler() {
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    shutdown = true;
+  }
+  frame_start.notify_all();
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+}
+
+int Upscaler::get_scale() const { return scale; }
+
+void Upscaler::run(const uint8_t *frame, uint32_t *dst, int pitch) {
+  int64_t start = monotonic_ns();
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    this->frame = frame;
+    this->dst = dst;
+    this->pitch = pitch;
+    bands_left = num_bands - 1;
+    generation++;
+  }
+  frame_start.notify_all();
+  run_band(0);
+  {
+    std::unique_lock<std::mutex> guard(lock);
+    frame_done.wait(guard, [this] { return bands_left == 0; });
+  }
+
+  int64_t cost = monotonic_ns() - start;
+  if (costs.size() < UPSCALE_SAMPLES) {
+    costs.push_back(cost);
+  } else {
+    costs[next_cost] = cost;
+  }
+  next_cost = (next_cost + 1) % UPSCALE_SAMPLES;
+}
+
+void Upscaler::worker_loop(int band) {
+  uint64_t seen = 0;
+  std::unique_lock<std::mutex> guard(lock);
+  while (true) {
+    frame_start.wait(guard,
+                     [this, seen] { return shutdown || generation != seen; });
+    if (shutdown) {
+      return;
+    }
+    seen = generation;
+    guard.unlock();
+    run_band(band);
+    guard.lock();
+    if (--bands_left == 0) {
+      frame_done.notify_one();
+    }
+  }
+}
+
+void Upscaler::run_band(int band) {
+  int first = SCREEN_HEIGHT * band / num_bands;
+  int last = SCREEN_HEIGHT * (band + 1) / num_bands;
+  const int out_width = SCREEN_WIDTH * scale;
+  uint8_t above[PADDED_WIDTH], row[PADDED_WIDTH], below[PADDED_WIDTH];
+  uint8_t out[3][SCREEN_WIDTH * 3];
+
+  for (int y = first; y < last; y++) {
+    uint8_t *out_row[3] = {out[0], out[1], out[2]};
+    if (filter == FILTER_NONE) {
+      out_row[0] = (uint8_t *)frame + y * SCREEN_WIDTH;
+    } else {
+      pad_row(frame + std::max(y - 1, 0) * SCREEN_WIDTH, above);
+      pad_row(frame + y * SCREEN_WIDTH, row);
+      pad_row(frame + std::min(y + 1, SCREEN_HEIGHT - 1) * SCREEN_WIDTH,
+              below);
+      if (filter == FILTER_SCALE2X) {
+        scale2x_row(above, row, below, out[0], out[1]);
+      } else {
+        scale3x_row(above, row, below, out[0], out[1], out[2]);
+      }
+    }
+    for (int i = 0; i < scale; i++) {
+      uint32_t *dst_row = (uint32_t *)((uint8_t *)dst + (y * scale + i) * pitch);
+      shades_to_rgba(out_row[i], dst_row, out_width, dmg_palette_rgba);
+    }
+  }
+}
+
+void Upscaler::print_stats() const {
+  if (costs.empty()) {
+    return;
+  }
+  std::vector<int64_t> sorted = costs;
+  std::sort(sorted.begin(), sorted.end());
+  const char *names[] = {"none", "scale2x", "scale3x"};
+  fprintf(stderr,
+          "Filter %s on %d threads: p50 %.3f ms, p99 %.3f ms, max %.3f ms per "
+          "frame\n",
+          names[filter], num_bands, sorted[sorted.size() / 2] / 1e6,
+          sorted[std::min(sorted.size() - 1, sorted.size() * 99 / 100)] / 1e6,
+          sorted.back() / 1e6);
+}
@@ -0,0 +1,138 @@
+#include "vec_env.hh"
+#include "gpu.hh"
+#include <algorithm>
+#include <cstring>
+
+VecEnv::VecEnv(char *rom_file, int num_envs, int num_threads) {
+  for (int i = 0; i < num_envs; i++) {
+    envs.push_back(std::make_unique<Gameboy>(rom_file, true));
+  }
+
+  if (num_threads <= 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  num_queues = std::max(1, std::min(num_threads, num_envs));
+  queues.reset(new WorkQueue[num_queues]);
+
+  actions = NULL;
+  repeat = 0;
+  frames_out = NULL;
+  ram_out = NULL;
+  obs_out = NULL;
+  generation = 0;
+  workers_busy = 0;
+  shutdown = false;
+
+  // the thread calling step works queue 0 itself
+  for (int id = 1; id < num_queues; id++) {
+    workers.emplace_back(&VecEnv::worker_loop, this, id);
+  }
+}
+
+VecEnv::~VecEnv() {
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    shutdown = true;
+  }
+  batch_start.notify_all();
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+}
+
+int VecEnv::size() const { return envs.size(); }
+
+Gameboy &VecEnv::env(int index) { return *envs[index]; }
+
+void VecEnv::set_ram_addresses(const std::vector<uint16_t> &addresses) {
+  ram_addresses = addresses;
+}
+
+void VecEnv::step(const uint8_t *actions, int repeat, uint8_t *frames_out,
+                  uint8_t *ram_out, Observation *obs_out) {
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    this->actions = actions;
+    this->repeat = repeat;
+    this->frames_out = frames_out;
+    this->ram_out = ram_out;
+    this->obs_out = obs_out;
+
+    // split the instances evenly; stealing evens out the rest
+    int num_envs = envs.size();
+    for (int q = 0; q < num_queues; q++) {
+      queues[q].next.store(num_envs * q / num_queues,
+                           std::memory_order_relaxed);
+      queues[q].end = num_envs * (q + 1) / num_queues;
+    }
+    workers_busy = workers.size();
+    generation++;
+  }
+  batch_start.notify_all();
+
+  run_queues(0);
+
+  std::unique_lock<std::mutex> guard(lock);
+  batch_done.wait(guard, [this] { return workers_busy == 0; });
+}
+
+void VecEnv::worker_loop(int id) {
+  uint64_t seen = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> guard(lock);
+      batch_start.wait(guard,
+                       [&] { return shutdown || generation != seen; });
+      if (shutdown) {
+        return;
+      }
+      seen = generation;
+    }
+
+    run_queues(id);
+
+    std::lock_guard<std::mutex> guard(lock);
+    if (--workers_busy == 0) {
+      batch_done.notify_one();
+    }
+  }
+}
+
+// drains the worker's own queue first, then steals from the others
+void VecEnv::run_queues(int id) {
+  for (int k = 0; k < num_queues; k++) {
+    WorkQueue &queue = queues[(id + k) % num_queues];
+    int index;
+    while ((index = queue.next.fetch_add(1, std::memory_order_relaxed)) <
+           queue.end) {
+      step_env(index);
+    }
+  }
+}
+
+void VecEnv::step_env(int index) {
+  Gameboy &gameboy = *envs[index];
+  gameboy.set_buttons(actions[index]);
+  if (obs_out != NULL) {
+    gameboy.enable_observation();
+  }
+  // only the last frame of a step can be observed, and only if asked for
+  for (int i = 0; i < repeat; i++) {
+    gameboy.run_frame(frames_out != NULL && i == repeat - 1);
+  }
+
+  if (frames_out != NULL) {
+    const size_t frame_pixels = SCREEN_WIDTH * SCREEN_HEIGHT;
+    memcpy(frames_out + index * frame_pixels, gameboy.get_screen(),
+           frame_pixels);
+  }
+  if (obs_out != NULL) {
+    obs_out[index] = gameboy.get_observation();
+  }
+  if (ram_out != NULL) {
+    uint8_t *ram = ram_out + index * ram_addresses.size();
+    for (size_t i = 0; i < ram_addresses.size(); i++) {
+      ram[i] = gameboy.peek_byte(ram_addresses[i]);
+    }
+  }
+}